@@ -0,0 +1,500 @@
+#pragma once
+
+#include "graph.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    /*
+     * Contraction hierarchy over DirectedWeightedGraph: vertices are contracted one by one in the order of
+     * their importance, and every shortest path through a contracted vertex is kept as a shortcut edge.
+     * A query is a bidirectional Dijkstra that only climbs to more important vertices, so it settles
+     * a small part of the graph; shortcuts on the found path are unpacked back into the graph's EdgeIds.
+     */
+    template <typename Weight>
+    class ContractionHierarchy {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+
+    public:
+        static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+        // Shortcut from -> to replacing the path first, second. Ids below the graph's edge count are
+        // the graph's own edges, the rest are shortcuts in the order of GetShortcuts()
+        struct Shortcut {
+            VertexId from;
+            VertexId to;
+            Weight weight;
+            EdgeId first;
+            EdgeId second;
+        };
+
+        struct Route {
+            Weight weight;
+            std::vector<EdgeId> edges;
+        };
+
+        // Everything needed to restore the hierarchy for the same graph; the arrays may refer to memory
+        // kept alive by the caller, e.g. a mapped base, and are then used in place
+        struct Data {
+            ranges::StoredArray<uint32_t> ranks;
+            ranges::StoredArray<Shortcut> shortcuts;
+        };
+
+        explicit ContractionHierarchy(const Graph& graph);
+        ContractionHierarchy(const Graph& graph, Data data);
+
+        std::optional<Route> FindRoute(VertexId from, VertexId to) const;
+
+        const ranges::StoredArray<uint32_t>& GetRanks() const {
+            return ranks_;
+        }
+        const ranges::StoredArray<Shortcut>& GetShortcuts() const {
+            return shortcuts_;
+        }
+
+    private:
+        // Edge of the search graph, stored at its less important end
+        struct UpwardEdge {
+            VertexId to;
+            Weight weight;
+            EdgeId id;
+        };
+
+        struct SearchSpace {
+            std::vector<Weight> distances;
+            std::vector<EdgeId> parents;
+            std::vector<VertexId> touched;
+
+            void Prepare(size_t vertex_count) {
+                if (distances.size() != vertex_count) {
+                    distances.assign(vertex_count, INFINITE_WEIGHT);
+                    parents.assign(vertex_count, NO_EDGE);
+                    touched.clear();
+                }
+            }
+
+            void Set(VertexId vertex, Weight distance, EdgeId parent) {
+                if (distances[vertex] == INFINITE_WEIGHT) {
+                    touched.push_back(vertex);
+                }
+                distances[vertex] = distance;
+                parents[vertex] = parent;
+            }
+
+            void Clear() {
+                for (VertexId vertex : touched) {
+                    distances[vertex] = INFINITE_WEIGHT;
+                    parents[vertex] = NO_EDGE;
+                }
+                touched.clear();
+            }
+        };
+
+        // Edge of the graph being contracted, stored at both ends
+        struct WorkEdge {
+            VertexId other;
+            Weight weight;
+            EdgeId id;
+        };
+
+        using QueueItem = std::pair<Weight, VertexId>;
+        using MinQueue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+
+        static constexpr Weight ZERO_WEIGHT{};
+        static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::max();
+
+        const Graph& graph_;
+        ranges::StoredArray<uint32_t> ranks_;
+        ranges::StoredArray<Shortcut> shortcuts_;
+
+        std::vector<size_t> upward_offsets_;
+        std::vector<UpwardEdge> upward_edges_;
+        std::vector<size_t> downward_offsets_;
+        std::vector<UpwardEdge> downward_edges_;
+
+        Shortcut GetSearchEdge(EdgeId id) const {
+            if (id < graph_.GetEdgeCount()) {
+                const Edge<Weight>& edge = graph_.GetEdge(id);
+                return { edge.from, edge.to, edge.weight, NO_EDGE, NO_EDGE };
+            }
+            return shortcuts_[id - graph_.GetEdgeCount()];
+        }
+
+        void Contract();
+        void BuildSearchGraph();
+        void UnpackEdge(EdgeId id, std::vector<EdgeId>& edges) const;
+    };
+
+    namespace detail {
+
+        // Work state of the contraction: the remaining graph as incoming and outgoing lists
+        template <typename Weight, typename WorkEdge, typename Shortcut>
+        class HierarchyBuilder {
+        public:
+            HierarchyBuilder(size_t vertex_count, size_t edge_count, std::vector<Shortcut>& shortcuts)
+                : incoming_(vertex_count)
+                , outgoing_(vertex_count)
+                , contracted_neighbours_(vertex_count, 0)
+                , witness_distances_(vertex_count, std::numeric_limits<Weight>::max())
+                , edge_count_(edge_count)
+                , shortcuts_(shortcuts) {
+            }
+
+            void AddEdge(VertexId from, VertexId to, Weight weight, EdgeId id) {
+                outgoing_[from].push_back({ to, weight, id });
+                incoming_[to].push_back({ from, weight, id });
+            }
+
+            // Shortcuts needed if vertex were contracted now: the cheapest edge u -> vertex -> w
+            // for every pair, unless a witness path u -> w avoiding vertex is not longer
+            std::vector<Shortcut> FindShortcuts(VertexId vertex) {
+                const std::vector<WorkEdge> incoming = CheapestEdges(incoming_[vertex]);
+                const std::vector<WorkEdge> outgoing = CheapestEdges(outgoing_[vertex]);
+                std::vector<Shortcut> result;
+                for (const WorkEdge& in : incoming) {
+                    Weight max_weight{};
+                    for (const WorkEdge& out : outgoing) {
+                        if (out.other != in.other) {
+                            max_weight = std::max(max_weight, in.weight + out.weight);
+                        }
+                    }
+                    RunWitnessSearch(in.other, vertex, max_weight);
+                    for (const WorkEdge& out : outgoing) {
+                        if (out.other == in.other) {
+                            continue;
+                        }
+                        const Weight weight = in.weight + out.weight;
+                        if (witness_distances_[out.other] > weight) {
+                            result.push_back({ in.other, out.other, weight, in.id, out.id });
+                        }
+                    }
+                    ClearWitnessSearch();
+                }
+                return result;
+            }
+
+            int ComputePriority(VertexId vertex) {
+                const int shortcut_count = static_cast<int>(FindShortcuts(vertex).size());
+                const int removed_count = static_cast<int>(incoming_[vertex].size() + outgoing_[vertex].size());
+                return shortcut_count - removed_count + contracted_neighbours_[vertex];
+            }
+
+            void ContractVertex(VertexId vertex) {
+                for (Shortcut& shortcut : FindShortcuts(vertex)) {
+                    const EdgeId id = edge_count_ + shortcuts_.size();
+                    AddEdge(shortcut.from, shortcut.to, shortcut.weight, id);
+                    shortcuts_.push_back(std::move(shortcut));
+                }
+                for (const WorkEdge& in : incoming_[vertex]) {
+                    RemoveEdgesTo(outgoing_[in.other], vertex);
+                    ++contracted_neighbours_[in.other];
+                }
+                for (const WorkEdge& out : outgoing_[vertex]) {
+                    RemoveEdgesTo(incoming_[out.other], vertex);
+                    ++contracted_neighbours_[out.other];
+                }
+                incoming_[vertex].clear();
+                incoming_[vertex].shrink_to_fit();
+                outgoing_[vertex].clear();
+                outgoing_[vertex].shrink_to_fit();
+            }
+
+        private:
+            std::vector<std::vector<WorkEdge>> incoming_;
+            std::vector<std::vector<WorkEdge>> outgoing_;
+            std::vector<int> contracted_neighbours_;
+            std::vector<Weight> witness_distances_;
+            std::vector<VertexId> witness_touched_;
+            size_t edge_count_;
+            std::vector<Shortcut>& shortcuts_;
+
+            static std::vector<WorkEdge> CheapestEdges(const std::vector<WorkEdge>& edges) {
+                std::vector<WorkEdge> result = edges;
+                std::sort(result.begin(), result.end(), [](const WorkEdge& lhs, const WorkEdge& rhs) {
+                    return lhs.other < rhs.other || (lhs.other == rhs.other && lhs.weight < rhs.weight);
+                });
+                result.erase(std::unique(result.begin(), result.end(), [](const WorkEdge& lhs, const WorkEdge& rhs) {
+                    return lhs.other == rhs.other;
+                }), result.end());
+                return result;
+            }
+
+            static void RemoveEdgesTo(std::vector<WorkEdge>& edges, VertexId vertex) {
+                edges.erase(std::remove_if(edges.begin(), edges.end(), [vertex](const WorkEdge& edge) {
+                    return edge.other == vertex;
+                }), edges.end());
+            }
+
+            void SetWitnessDistance(VertexId vertex, Weight distance) {
+                if (witness_distances_[vertex] == std::numeric_limits<Weight>::max()) {
+                    witness_touched_.push_back(vertex);
+                }
+                witness_distances_[vertex] = distance;
+            }
+
+            void RunWitnessSearch(VertexId from, VertexId excluded, Weight max_weight) {
+                using QueueItem = std::pair<Weight, VertexId>;
+                std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+                SetWitnessDistance(from, Weight{});
+                queue.push({ Weight{}, from });
+                size_t settled = 0;
+                while (!queue.empty() && settled < WITNESS_SETTLE_LIMIT) {
+                    const auto [distance, vertex] = queue.top();
+                    queue.pop();
+                    if (distance > witness_distances_[vertex]) {
+                        continue;
+                    }
+                    if (distance > max_weight) {
+                        break;
+                    }
+                    ++settled;
+                    for (const WorkEdge& edge : outgoing_[vertex]) {
+                        if (edge.other == excluded) {
+                            continue;
+                        }
+                        const Weight candidate = distance + edge.weight;
+                        if (candidate < witness_distances_[edge.other]) {
+                            SetWitnessDistance(edge.other, candidate);
+                            queue.push({ candidate, edge.other });
+                        }
+                    }
+                }
+            }
+
+            void ClearWitnessSearch() {
+                for (VertexId vertex : witness_touched_) {
+                    witness_distances_[vertex] = std::numeric_limits<Weight>::max();
+                }
+                witness_touched_.clear();
+            }
+
+            // Witness searches give up after settling this many vertices; an extra shortcut is harmless
+            static constexpr size_t WITNESS_SETTLE_LIMIT = 500;
+        };
+
+    } // namespace detail
+
+    template <typename Weight>
+    ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph)
+        : graph_(graph) {
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+        Contract();
+        BuildSearchGraph();
+    }
+
+    template <typename Weight>
+    ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph, Data data)
+        : graph_(graph)
+        , ranks_(std::move(data.ranks))
+        , shortcuts_(std::move(data.shortcuts)) {
+        if (ranks_.size() != graph.GetVertexCount()) {
+            throw std::invalid_argument("Contraction hierarchy does not match the graph");
+        }
+        // Ranks must be a permutation of the vertices
+        std::vector<bool> rank_taken(ranks_.size(), false);
+        for (uint32_t rank : ranks_) {
+            if (rank >= ranks_.size() || rank_taken[rank]) {
+                throw std::invalid_argument("Contraction hierarchy does not match the graph");
+            }
+            rank_taken[rank] = true;
+        }
+        // A shortcut may only consist of edges and earlier shortcuts, so that unpacking terminates
+        for (size_t i = 0; i < shortcuts_.size(); ++i) {
+            const Shortcut& shortcut = shortcuts_[i];
+            const EdgeId shortcut_id = graph.GetEdgeCount() + i;
+            if (shortcut.from >= ranks_.size() || shortcut.to >= ranks_.size()
+                || shortcut.first >= shortcut_id || shortcut.second >= shortcut_id) {
+                throw std::invalid_argument("Contraction hierarchy does not match the graph");
+            }
+        }
+        BuildSearchGraph();
+    }
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::Contract() {
+        const size_t vertex_count = graph_.GetVertexCount();
+        detail::HierarchyBuilder<Weight, WorkEdge, Shortcut> builder(vertex_count, graph_.GetEdgeCount(), shortcuts_.GetMutable());
+        for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+            const Edge<Weight>& edge = graph_.GetEdge(edge_id);
+            if (edge.from != edge.to) {
+                builder.AddEdge(edge.from, edge.to, edge.weight, edge_id);
+            }
+        }
+
+        // Lazy updates: a popped vertex is contracted only if its recomputed priority is still the smallest
+        using PriorityItem = std::pair<int, VertexId>;
+        std::priority_queue<PriorityItem, std::vector<PriorityItem>, std::greater<PriorityItem>> queue;
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            queue.push({ builder.ComputePriority(vertex), vertex });
+        }
+        std::vector<uint32_t>& ranks = ranks_.GetMutable();
+        ranks.assign(vertex_count, 0);
+        uint32_t next_rank = 0;
+        while (!queue.empty()) {
+            const VertexId vertex = queue.top().second;
+            queue.pop();
+            const int priority = builder.ComputePriority(vertex);
+            if (!queue.empty() && priority > queue.top().first) {
+                queue.push({ priority, vertex });
+                continue;
+            }
+            builder.ContractVertex(vertex);
+            ranks[vertex] = next_rank++;
+        }
+    }
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::BuildSearchGraph() {
+        const size_t vertex_count = graph_.GetVertexCount();
+        const EdgeId edge_count = graph_.GetEdgeCount() + shortcuts_.size();
+        upward_offsets_.assign(vertex_count + 1, 0);
+        downward_offsets_.assign(vertex_count + 1, 0);
+        for (EdgeId id = 0; id < edge_count; ++id) {
+            const Shortcut edge = GetSearchEdge(id);
+            if (edge.from == edge.to) {
+                continue;
+            }
+            if (ranks_[edge.from] < ranks_[edge.to]) {
+                ++upward_offsets_[edge.from + 1];
+            }
+            else {
+                ++downward_offsets_[edge.to + 1];
+            }
+        }
+        for (size_t i = 0; i < vertex_count; ++i) {
+            upward_offsets_[i + 1] += upward_offsets_[i];
+            downward_offsets_[i + 1] += downward_offsets_[i];
+        }
+
+        upward_edges_.resize(upward_offsets_.back());
+        downward_edges_.resize(downward_offsets_.back());
+        std::vector<size_t> upward_next(upward_offsets_.begin(), upward_offsets_.end() - 1);
+        std::vector<size_t> downward_next(downward_offsets_.begin(), downward_offsets_.end() - 1);
+        for (EdgeId id = 0; id < edge_count; ++id) {
+            const Shortcut edge = GetSearchEdge(id);
+            if (edge.from == edge.to) {
+                continue;
+            }
+            if (ranks_[edge.from] < ranks_[edge.to]) {
+                upward_edges_[upward_next[edge.from]++] = { edge.to, edge.weight, id };
+            }
+            else {
+                // The backward search walks this edge from `to` up to `from`
+                downward_edges_[downward_next[edge.to]++] = { edge.from, edge.weight, id };
+            }
+        }
+    }
+
+    template <typename Weight>
+    std::optional<typename ContractionHierarchy<Weight>::Route> ContractionHierarchy<Weight>::FindRoute(VertexId from, VertexId to) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (from >= vertex_count || to >= vertex_count) {
+            throw std::out_of_range("Vertex is out of range");
+        }
+        if (from == to) {
+            return Route{ ZERO_WEIGHT, {} };
+        }
+
+        // Work arrays are reused between queries of one thread and cleared through the touched lists
+        thread_local SearchSpace forward;
+        thread_local SearchSpace backward;
+        forward.Prepare(vertex_count);
+        backward.Prepare(vertex_count);
+
+        MinQueue forward_queue;
+        MinQueue backward_queue;
+        forward.Set(from, ZERO_WEIGHT, NO_EDGE);
+        backward.Set(to, ZERO_WEIGHT, NO_EDGE);
+        forward_queue.push({ ZERO_WEIGHT, from });
+        backward_queue.push({ ZERO_WEIGHT, to });
+
+        Weight best = INFINITE_WEIGHT;
+        std::optional<VertexId> meeting;
+        while (!forward_queue.empty() || !backward_queue.empty()) {
+            const bool is_forward = !forward_queue.empty()
+                && (backward_queue.empty() || forward_queue.top().first <= backward_queue.top().first);
+            MinQueue& queue = is_forward ? forward_queue : backward_queue;
+            SearchSpace& space = is_forward ? forward : backward;
+            const SearchSpace& other = is_forward ? backward : forward;
+
+            const auto [distance, vertex] = queue.top();
+            queue.pop();
+            if (distance >= best) {
+                // Every vertex left in this queue is at least as far
+                queue = MinQueue();
+                continue;
+            }
+            if (distance > space.distances[vertex]) {
+                continue;
+            }
+            if (other.distances[vertex] != INFINITE_WEIGHT && distance + other.distances[vertex] < best) {
+                best = distance + other.distances[vertex];
+                meeting = vertex;
+            }
+
+            const std::vector<size_t>& offsets = is_forward ? upward_offsets_ : downward_offsets_;
+            const std::vector<UpwardEdge>& edges = is_forward ? upward_edges_ : downward_edges_;
+            for (size_t i = offsets[vertex]; i < offsets[vertex + 1]; ++i) {
+                const UpwardEdge& edge = edges[i];
+                const Weight candidate = distance + edge.weight;
+                if (candidate < space.distances[edge.to]) {
+                    space.Set(edge.to, candidate, edge.id);
+                    queue.push({ candidate, edge.to });
+                }
+            }
+        }
+
+        std::optional<Route> route;
+        if (meeting) {
+            std::vector<EdgeId> path;
+            for (VertexId vertex = *meeting; forward.parents[vertex] != NO_EDGE;) {
+                path.push_back(forward.parents[vertex]);
+                vertex = GetSearchEdge(forward.parents[vertex]).from;
+            }
+            std::reverse(path.begin(), path.end());
+            for (VertexId vertex = *meeting; backward.parents[vertex] != NO_EDGE;) {
+                path.push_back(backward.parents[vertex]);
+                vertex = GetSearchEdge(backward.parents[vertex]).to;
+            }
+
+            route = Route{ best, {} };
+            for (EdgeId id : path) {
+                UnpackEdge(id, route->edges);
+            }
+        }
+        forward.Clear();
+        backward.Clear();
+        return route;
+    }
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::UnpackEdge(EdgeId id, std::vector<EdgeId>& edges) const {
+        std::vector<EdgeId> stack = { id };
+        while (!stack.empty()) {
+            const EdgeId current = stack.back();
+            stack.pop_back();
+            if (current < graph_.GetEdgeCount()) {
+                edges.push_back(current);
+                continue;
+            }
+            const Shortcut& shortcut = shortcuts_[current - graph_.GetEdgeCount()];
+            stack.push_back(shortcut.second);
+            stack.push_back(shortcut.first);
+        }
+    }
+
+}  // namespace graph
@@ -6,7 +6,7 @@ namespace TransportCatalogue {
     using namespace std::literals;
 
     Stop::Stop(std::string_view name, geo::Coordinates coordinates_)
-        : name_stop(std::string(name)), coordinates(coordinates_) {
+        : name_stop(name), coordinates(coordinates_) {
     }
 
     bool Stop::operator==(const Stop& other) const {
@@ -14,7 +14,7 @@ namespace TransportCatalogue {
     }
 
     Bus::Bus(std::string_view name, bool loop, BusStaticInformation inform)
-        : name_bus(std::string(name)), looping(loop), static_infom(inform) {
+        : name_bus(name), looping(loop), static_infom(inform) {
     }
 
     bool Bus::operator==(const Bus& other) const {
@@ -35,10 +35,6 @@ namespace TransportCatalogue {
             return out;
         }
 
-        size_t HasherPairStops::operator()(const std::pair<const Stop*, const Stop*>& plate) const {
-            return hasher(plate.first) + hasher(plate.second) * 38;
-        }
-
         bool BusHasher::operator()(const Bus* lhs, const Bus* rhs) const {
             return std::lexicographical_compare(lhs->name_bus.begin(), lhs->name_bus.end(),
                 rhs->name_bus.begin(), rhs->name_bus.end());
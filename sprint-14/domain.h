@@ -1,6 +1,8 @@
 #pragma once
 
 #include "geo.h"
+#include "ranges.h"
+#include <cstdint>
 #include <string>
 #include <iostream>
 #include <string_view>
@@ -9,6 +11,12 @@
 
 namespace TransportCatalogue {
 
+    // Dense ids assigned in insertion order, usable as array indexes
+    using StopId = uint32_t;
+    using BusId = uint32_t;
+    // Stop ids of a route, kept by the catalogue or in a mapped base
+    using RouteRange = ranges::Range<const StopId*>;
+
     struct Stop {
 
         Stop(std::string_view name, geo::Coordinates coordinates_);
@@ -16,8 +24,10 @@ namespace TransportCatalogue {
 
         bool operator==(const Stop& other) const;
 
-        std::string name_stop;
+        // Kept by the catalogue or in a mapped base
+        std::string_view name_stop;
         geo::Coordinates coordinates;
+        StopId id = 0;
     };
 
     struct BusStaticInformation {
@@ -38,15 +48,23 @@ namespace TransportCatalogue {
 
         bool operator==(const Bus& other) const;
 
-        std::vector<std::string_view> stops_for_bus_ = {};
-        std::string name_bus;
+        RouteRange route;
+        // Kept by the catalogue or in a mapped base
+        std::string_view name_bus;
         bool looping;
         BusStaticInformation static_infom;
+        BusId id = 0;
+    };
+
+    enum class GraphModel {
+        STOP_PAIRS,     // an edge from every stop to every later stop of a bus: O(n^2) edges per route
+        TRANSFER_NODES, // a vertex per stop of every route, linked by board, ride and alight edges: O(n) per route
     };
 
     struct BusTimesSettings {
         double bus_wait_time_ = 0.0;
         double bus_velocity_m_m_ = 0.0; //meters per minute
+        GraphModel graph_model_ = GraphModel::STOP_PAIRS;
     };
 
     namespace detail {
@@ -67,11 +85,6 @@ namespace TransportCatalogue {
 
         std::ostream& operator<<(std::ostream& out, const InformationBus& doc);
 
-        struct HasherPairStops {
-            size_t operator()(const std::pair<const Stop*, const Stop*>& plate) const;
-            std::hash<const void*> hasher;
-        };
-
         struct BusHasher {
             bool operator()(const Bus* lhs, const Bus* rhs) const;
         };
@@ -0,0 +1,473 @@
+#include "flat_base.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace serialization {
+
+	namespace flat_base {
+
+		namespace {
+
+			using namespace std::literals;
+			using TransportCatalogue::StopId;
+			using TransportCatalogue::BusId;
+			using TransportCatalogue::DistanceEntry;
+			using TransportCatalogue::transport_router::EdgeKind;
+			using TransportCatalogue::transport_router::TGraphEdge;
+			using TransportCatalogue::transport_router::TransportRouter;
+			using Shortcut = graph::ContractionHierarchy<double>::Shortcut;
+
+			constexpr std::array<char, 8> MAGIC = { 'T', 'C', 'F', 'L', 'A', 'T', '\0', '\0' };
+			constexpr uint32_t VERSION = 3;
+			constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+			constexpr size_t SECTION_ALIGNMENT = 8;
+
+			enum Section : uint32_t {
+				SETTINGS,
+				STRINGS,
+				STOPS,
+				BUSES,
+				ROUTE_STOPS,
+				DISTANCE_OFFSETS,
+				DISTANCES,
+				GRAPH_EDGES,
+				ROUTE_EDGES,
+				STOP_VERTEXES,
+				ALL_PAIRS_WEIGHTS,
+				ALL_PAIRS_PREV_EDGES,
+				HIERARCHY_RANKS,
+				HIERARCHY_SHORTCUTS,
+				STOPS_BY_NAME,
+				BUSES_BY_NAME,
+				SECTION_COUNT,
+			};
+
+			struct SectionEntry {
+				uint64_t offset = 0;
+				uint64_t size = 0;
+			};
+
+			struct Header {
+				std::array<char, 8> magic = MAGIC;
+				uint32_t version = VERSION;
+				uint32_t byte_order = BYTE_ORDER_MARK;
+				uint32_t word_size = sizeof(size_t);
+				uint32_t has_graph = 0;
+				uint64_t vertex_count = 0;
+				std::array<SectionEntry, SECTION_COUNT> sections = {};
+			};
+
+			// Names are [name_offset, name_offset + name_size) of the STRINGS section
+			struct FlatStop {
+				double lat;
+				double lng;
+				uint32_t name_offset;
+				uint32_t name_size;
+			};
+
+			// Stops of the bus are [route_offset, route_offset + route_size) of the ROUTE_STOPS section;
+			// stop_count and unique_stop_count are those of Bus requests, stored so that routes aren't sorted on reading
+			struct FlatBus {
+				uint32_t name_offset;
+				uint32_t name_size;
+				uint32_t route_offset;
+				uint32_t route_size;
+				int32_t stop_count;
+				int32_t unique_stop_count;
+				int32_t route_length;
+				uint32_t looping;
+				double curvature;
+			};
+
+			// Metadata of the graph edge with the same index
+			struct FlatRouteEdge {
+				StopId stop;
+				BusId bus;
+				uint32_t span_count;
+				uint32_t kind;
+			};
+
+			struct FlatStopVertex {
+				StopId stop;
+				uint32_t vertex;
+			};
+
+			static_assert(std::is_trivially_copyable_v<DistanceEntry>);
+			static_assert(std::is_trivially_copyable_v<graph::Edge<double>>);
+			static_assert(std::is_trivially_copyable_v<Shortcut>);
+
+			class BaseWriter {
+			public:
+				explicit BaseWriter(const std::string& file_name)
+					: out_(file_name, std::ios::binary) {
+					if (!out_) {
+						throw std::runtime_error("Can't open "s + file_name);
+					}
+					out_.write(reinterpret_cast<const char*>(&header_), sizeof(header_));
+				}
+
+				Header& GetHeader() {
+					return header_;
+				}
+
+				template <typename T>
+				void WriteSection(Section section, const T* data, size_t count) {
+					BeginSection(section);
+					AppendToSection(section, data, count);
+				}
+
+				// Starts a section written in parts with AppendToSection
+				void BeginSection(Section section) {
+					const uint64_t position = static_cast<uint64_t>(out_.tellp());
+					const uint64_t padding = (SECTION_ALIGNMENT - position % SECTION_ALIGNMENT) % SECTION_ALIGNMENT;
+					static constexpr char zeros[SECTION_ALIGNMENT] = {};
+					out_.write(zeros, padding);
+					header_.sections[section] = { position + padding, 0 };
+				}
+
+				template <typename T>
+				void AppendToSection(Section section, const T* data, size_t count) {
+					static_assert(std::is_trivially_copyable_v<T>);
+					header_.sections[section].size += count * sizeof(T);
+					out_.write(reinterpret_cast<const char*>(data), count * sizeof(T));
+				}
+
+				template <typename T>
+				void WriteSection(Section section, const std::vector<T>& data) {
+					WriteSection(section, data.data(), data.size());
+				}
+
+				void Finish() {
+					out_.seekp(0);
+					out_.write(reinterpret_cast<const char*>(&header_), sizeof(header_));
+					if (!out_) {
+						throw std::runtime_error("Can't write the base"s);
+					}
+				}
+
+			private:
+				std::ofstream out_;
+				Header header_;
+			};
+
+			class BaseReader {
+			public:
+				explicit BaseReader(const MappedFile& file)
+					: file_(file) {
+					if (file_.GetSize() < sizeof(Header)) {
+						throw std::runtime_error("Not a flat base"s);
+					}
+					std::memcpy(&header_, file_.GetData(), sizeof(Header));
+					if (header_.magic != MAGIC) {
+						throw std::runtime_error("Not a flat base"s);
+					}
+					if (header_.version != VERSION || header_.byte_order != BYTE_ORDER_MARK || header_.word_size != sizeof(size_t)) {
+						throw std::runtime_error("Flat base was written by an incompatible program"s);
+					}
+				}
+
+				const Header& GetHeader() const {
+					return header_;
+				}
+
+				template <typename T>
+				ranges::Range<const T*> GetSection(Section section) const {
+					const SectionEntry& entry = header_.sections[section];
+					if (entry.offset > file_.GetSize() || entry.size > file_.GetSize() - entry.offset
+						|| entry.offset % alignof(T) != 0 || entry.size % sizeof(T) != 0) {
+						throw std::runtime_error("Flat base is damaged"s);
+					}
+					const T* first = reinterpret_cast<const T*>(file_.GetData() + entry.offset);
+					return { first, first + entry.size / sizeof(T) };
+				}
+
+				std::string_view GetString(uint32_t offset, uint32_t size) const {
+					const auto strings = GetSection<char>(STRINGS);
+					if (offset > strings.end() - strings.begin() || size > strings.end() - strings.begin() - offset) {
+						throw std::runtime_error("Flat base is damaged"s);
+					}
+					return { strings.begin() + offset, size };
+				}
+
+			private:
+				const MappedFile& file_;
+				Header header_;
+			};
+
+			uint32_t AppendString(std::string& strings, std::string_view str) {
+				const uint32_t offset = static_cast<uint32_t>(strings.size());
+				strings.append(str);
+				return offset;
+			}
+
+			void WriteRouter(BaseWriter& writer, const TransportCatalogue::TransportCatalogue& catalog, const TransportRouter& router) {
+				const graph::DirectedWeightedGraph<double>& graph = router.GetGraph();
+				writer.GetHeader().has_graph = 1;
+				writer.GetHeader().vertex_count = graph.GetVertexCount();
+
+				std::vector<graph::Edge<double>> graph_edges;
+				graph_edges.reserve(graph.GetEdgeCount());
+				std::vector<FlatRouteEdge> route_edges;
+				route_edges.reserve(graph.GetEdgeCount());
+				for (const TGraphEdge& edge : router.GetEdges()) {
+					graph_edges.push_back(graph.GetEdge(edge.id));
+					route_edges.push_back({ catalog.FindStop(edge.from)->id, catalog.FindBus(edge.name)->id,
+						                    static_cast<uint32_t>(edge.span_count_), static_cast<uint32_t>(edge.kind) });
+				}
+				writer.WriteSection(GRAPH_EDGES, graph_edges);
+				writer.WriteSection(ROUTE_EDGES, route_edges);
+
+				std::vector<FlatStopVertex> stop_vertexes;
+				stop_vertexes.reserve(router.GetStopVertexes().size());
+				for (const auto& [stop, vertex] : router.GetStopVertexes()) {
+					stop_vertexes.push_back({ catalog.FindStop(stop)->id, static_cast<uint32_t>(vertex) });
+				}
+				writer.WriteSection(STOP_VERTEXES, stop_vertexes);
+
+				// Row by row, so that the matrices aren't copied; a pass per section keeps each contiguous
+				const size_t vertex_count = graph.GetVertexCount();
+				writer.BeginSection(ALL_PAIRS_WEIGHTS);
+				const bool has_all_pairs = router.GetRouter()->ForEachAllPairsRow([&writer, vertex_count](graph::VertexId, const double* weights, const uint32_t*) {
+					writer.AppendToSection(ALL_PAIRS_WEIGHTS, weights, vertex_count);
+				});
+				if (has_all_pairs) {
+					writer.BeginSection(ALL_PAIRS_PREV_EDGES);
+					router.GetRouter()->ForEachAllPairsRow([&writer, vertex_count](graph::VertexId, const double*, const uint32_t* prev_edges) {
+						writer.AppendToSection(ALL_PAIRS_PREV_EDGES, prev_edges, vertex_count);
+					});
+				}
+				if (const graph::ContractionHierarchy<double>* hierarchy = router.GetRouter()->GetContractionHierarchy()) {
+					writer.WriteSection(HIERARCHY_RANKS, hierarchy->GetRanks().data(), hierarchy->GetRanks().size());
+					writer.WriteSection(HIERARCHY_SHORTCUTS, hierarchy->GetShortcuts().data(), hierarchy->GetShortcuts().size());
+				}
+			}
+
+			void ReadRouter(const BaseReader& reader, const TransportCatalogue::TransportCatalogue& catalog, TransportRouter& router) {
+				const std::deque<TransportCatalogue::Stop>& stops = catalog.GetStopsConst();
+				const std::deque<TransportCatalogue::Bus>& buses = catalog.GetBusesConst();
+				const auto graph_edges = reader.GetSection<graph::Edge<double>>(GRAPH_EDGES);
+				const auto route_edges = reader.GetSection<FlatRouteEdge>(ROUTE_EDGES);
+				if (graph_edges.end() - graph_edges.begin() != route_edges.end() - route_edges.begin()) {
+					throw std::runtime_error("Flat base is damaged"s);
+				}
+
+				std::vector<TGraphEdge> edges;
+				edges.reserve(route_edges.end() - route_edges.begin());
+				for (const FlatRouteEdge& edge : route_edges) {
+					if (edge.stop >= stops.size() || edge.bus >= buses.size() || edge.kind > static_cast<uint32_t>(EdgeKind::ALIGHT)) {
+						throw std::runtime_error("Flat base is damaged"s);
+					}
+					const graph::EdgeId id = edges.size();
+					edges.push_back({ id, stops[edge.stop].name_stop, buses[edge.bus].name_bus, edge.span_count,
+						              graph_edges.begin()[id].weight, static_cast<EdgeKind>(edge.kind) });
+				}
+
+				TransportRouter::StopVertexes vertexes;
+				for (const FlatStopVertex& stop_vertex : reader.GetSection<FlatStopVertex>(STOP_VERTEXES)) {
+					if (stop_vertex.stop >= stops.size() || stop_vertex.vertex >= reader.GetHeader().vertex_count) {
+						throw std::runtime_error("Flat base is damaged"s);
+					}
+					vertexes[stops[stop_vertex.stop].name_stop] = stop_vertex.vertex;
+				}
+
+				try {
+					router.RestoreGraph(graph::DirectedWeightedGraph<double>(reader.GetHeader().vertex_count, graph_edges),
+						                std::move(edges), std::move(vertexes));
+				}
+				catch (const std::out_of_range&) {
+					throw std::runtime_error("Flat base is damaged"s);
+				}
+
+				// Tables that don't fit the graph are rejected later by the router itself; both are used in place
+				const auto weights = reader.GetSection<double>(ALL_PAIRS_WEIGHTS);
+				if (!weights.empty()) {
+					router.SetAllPairsData({ weights, reader.GetSection<uint32_t>(ALL_PAIRS_PREV_EDGES) });
+				}
+				const auto ranks = reader.GetSection<uint32_t>(HIERARCHY_RANKS);
+				if (ranks.begin() != ranks.end()) {
+					router.SetContractionHierarchyData({ ranks, reader.GetSection<Shortcut>(HIERARCHY_SHORTCUTS) });
+				}
+			}
+
+		} //namespace
+
+		MappedFile::MappedFile(const std::string& file_name) {
+#ifdef _WIN32
+			std::ifstream input(file_name, std::ios::binary);
+			if (!input) {
+				throw std::runtime_error("Can't open "s + file_name);
+			}
+			buffer_.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+			data_ = buffer_.data();
+			size_ = buffer_.size();
+#else
+			const int fd = open(file_name.c_str(), O_RDONLY);
+			if (fd < 0) {
+				throw std::runtime_error("Can't open "s + file_name);
+			}
+			struct stat file_stat {};
+			if (fstat(fd, &file_stat) != 0) {
+				close(fd);
+				throw std::runtime_error("Can't read "s + file_name);
+			}
+			size_ = static_cast<size_t>(file_stat.st_size);
+			if (size_ > 0) {
+				void* address = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (address == MAP_FAILED) {
+					close(fd);
+					throw std::runtime_error("Can't map "s + file_name);
+				}
+				data_ = static_cast<const char*>(address);
+			}
+			close(fd);
+#endif
+		}
+
+		MappedFile::~MappedFile() {
+#ifndef _WIN32
+			if (data_ != nullptr) {
+				munmap(const_cast<char*>(data_), size_);
+			}
+#endif
+		}
+
+		void WriteBase(const std::string& file_name,
+			           const TransportCatalogue::TransportCatalogue& catalog,
+			           const TransportRouter& router,
+			           const std::string& settings) {
+			const std::deque<TransportCatalogue::Stop>& stops = catalog.GetStopsConst();
+			const std::deque<TransportCatalogue::Bus>& buses = catalog.GetBusesConst();
+			std::string strings;
+			std::vector<FlatStop> flat_stops;
+			flat_stops.reserve(stops.size());
+			for (const TransportCatalogue::Stop& stop : stops) {
+				const uint32_t name_offset = AppendString(strings, stop.name_stop);
+				flat_stops.push_back({ stop.coordinates.lat, stop.coordinates.lng, name_offset, static_cast<uint32_t>(stop.name_stop.size()) });
+			}
+
+			std::vector<FlatBus> flat_buses;
+			flat_buses.reserve(buses.size());
+			std::vector<StopId> route_stops;
+			for (const TransportCatalogue::Bus& bus : buses) {
+				const TransportCatalogue::RouteRange route = catalog.GetRoute(bus.id);
+				const TransportCatalogue::detail::InformationBus info = catalog.GetInformationBus(bus.id);
+				const uint32_t name_offset = AppendString(strings, bus.name_bus);
+				flat_buses.push_back({ name_offset, static_cast<uint32_t>(bus.name_bus.size()),
+					                   static_cast<uint32_t>(route_stops.size()), static_cast<uint32_t>(route.size()),
+					                   bus.static_infom.number_stops, bus.static_infom.number_stops_un,
+					                   info.distance, bus.looping ? 1u : 0u, info.curv });
+				route_stops.insert(route_stops.end(), route.begin(), route.end());
+			}
+
+			std::vector<uint32_t> distance_offsets = { 0 };
+			distance_offsets.reserve(stops.size() + 1);
+			std::vector<DistanceEntry> distances;
+			for (StopId from = 0; from < stops.size(); ++from) {
+				const auto row = catalog.GetDistancesFrom(from);
+				distances.insert(distances.end(), row.begin(), row.end());
+				distance_offsets.push_back(static_cast<uint32_t>(distances.size()));
+			}
+
+			// Ids sorted by name and then by id serve name lookups, see TransportCatalogue::UseNameOrder
+			std::vector<StopId> stops_by_name(stops.size());
+			std::iota(stops_by_name.begin(), stops_by_name.end(), StopId{ 0 });
+			std::sort(stops_by_name.begin(), stops_by_name.end(), [&stops](StopId lhs, StopId rhs) {
+				return std::tie(stops[lhs].name_stop, lhs) < std::tie(stops[rhs].name_stop, rhs);
+			});
+			std::vector<BusId> buses_by_name(buses.size());
+			std::iota(buses_by_name.begin(), buses_by_name.end(), BusId{ 0 });
+			std::sort(buses_by_name.begin(), buses_by_name.end(), [&buses](BusId lhs, BusId rhs) {
+				return std::tie(buses[lhs].name_bus, lhs) < std::tie(buses[rhs].name_bus, rhs);
+			});
+
+			BaseWriter writer(file_name);
+			writer.WriteSection(SETTINGS, settings.data(), settings.size());
+			writer.WriteSection(STRINGS, strings.data(), strings.size());
+			writer.WriteSection(STOPS, flat_stops);
+			writer.WriteSection(BUSES, flat_buses);
+			writer.WriteSection(ROUTE_STOPS, route_stops);
+			writer.WriteSection(DISTANCE_OFFSETS, distance_offsets);
+			writer.WriteSection(DISTANCES, distances);
+			writer.WriteSection(STOPS_BY_NAME, stops_by_name);
+			writer.WriteSection(BUSES_BY_NAME, buses_by_name);
+			if (router.GetRouter() != nullptr) {
+				WriteRouter(writer, catalog, router);
+			}
+			writer.Finish();
+		}
+
+		bool IsFlatBase(const std::string& file_name) {
+			std::ifstream input(file_name, std::ios::binary);
+			std::array<char, MAGIC.size()> magic = {};
+			input.read(magic.data(), magic.size());
+			return input && magic == MAGIC;
+		}
+
+		std::string ReadBase(const MappedFile& file,
+			                 TransportCatalogue::TransportCatalogue& catalog,
+			                 TransportRouter& router) {
+			const BaseReader reader(file);
+
+			catalog.UseNameOrder(reader.GetSection<StopId>(STOPS_BY_NAME), reader.GetSection<BusId>(BUSES_BY_NAME));
+			for (const FlatStop& stop : reader.GetSection<FlatStop>(STOPS)) {
+				catalog.AddStopInPlace(reader.GetString(stop.name_offset, stop.name_size), { stop.lat, stop.lng });
+			}
+
+			const auto route_stops = reader.GetSection<StopId>(ROUTE_STOPS);
+			const auto flat_buses = reader.GetSection<FlatBus>(BUSES);
+			std::vector<TransportCatalogue::detail::InformationBus> statistics;
+			statistics.reserve(flat_buses.end() - flat_buses.begin());
+			for (const FlatBus& bus : flat_buses) {
+				if (bus.route_offset > route_stops.end() - route_stops.begin()
+					|| bus.route_size > route_stops.end() - route_stops.begin() - bus.route_offset) {
+					throw std::runtime_error("Flat base is damaged"s);
+				}
+				const StopId* route = route_stops.begin() + bus.route_offset;
+				try {
+					catalog.AddBusInPlace(reader.GetString(bus.name_offset, bus.name_size), bus.looping != 0,
+						                  TransportCatalogue::RouteRange{ route, route + bus.route_size },
+						                  { bus.stop_count, bus.unique_stop_count });
+				}
+				catch (const std::out_of_range&) {
+					throw std::runtime_error("Flat base is damaged"s);
+				}
+				statistics.emplace_back(catalog.GetBusesConst().back().static_infom, bus.route_length, bus.curvature);
+			}
+
+			try {
+				catalog.RestoreDistances(reader.GetSection<uint32_t>(DISTANCE_OFFSETS), reader.GetSection<DistanceEntry>(DISTANCES));
+			}
+			catch (const std::invalid_argument&) {
+				throw std::runtime_error("Flat base is damaged"s);
+			}
+			catalog.RestoreBusStatistics(std::move(statistics));
+			catalog.Finalize();
+
+			if (reader.GetHeader().has_graph != 0) {
+				ReadRouter(reader, catalog, router);
+			}
+
+			const auto settings = reader.GetSection<char>(SETTINGS);
+			return { settings.begin(), settings.end() };
+		}
+
+	} //flat_base
+
+} //serialization
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace serialization {
+
+	/*
+	 * Flat base format: a header with a section table followed by arrays in the machine's own layout,
+	 * each aligned to 8 bytes. The file is mapped into memory, and the catalogue and the router use its
+	 * arrays and names in place: routes, distances, graph edges, all-pairs matrices and the hierarchy.
+	 * Name lookups go by binary search over stored id tables sorted by name instead of hash tables.
+	 * Reading is not free of per-record work: a record is still made for every stop, bus and graph edge,
+	 * and the graph's rows and the hierarchy's search graph are rebuilt. Stored tables are checked only
+	 * for size and along what is used. Bases written on a machine with another byte order or word size
+	 * are rejected.
+	 */
+	namespace flat_base {
+
+		// Read-only view of the whole file; on POSIX it is mapped, elsewhere read into memory
+		class MappedFile {
+		public:
+			// Throws std::runtime_error if the file can't be read
+			explicit MappedFile(const std::string& file_name);
+			MappedFile(const MappedFile&) = delete;
+			MappedFile& operator=(const MappedFile&) = delete;
+			~MappedFile();
+
+			const char* GetData() const {
+				return data_;
+			}
+
+			size_t GetSize() const {
+				return size_;
+			}
+
+		private:
+			const char* data_ = nullptr;
+			size_t size_ = 0;
+#ifdef _WIN32
+			std::vector<char> buffer_;
+#endif
+		};
+
+		// settings is an opaque blob stored along with the data, e.g. a serialized protobuf message
+		void WriteBase(const std::string& file_name,
+			           const TransportCatalogue::TransportCatalogue& catalog,
+			           const TransportCatalogue::transport_router::TransportRouter& router,
+			           const std::string& settings);
+
+		bool IsFlatBase(const std::string& file_name);
+
+		// Fills an empty catalogue and the router's graph and tables, and returns the settings blob. They refer
+		// to the file's memory, so it must outlive them; throws std::runtime_error if the base is damaged
+		// or comes from an incompatible machine
+		std::string ReadBase(const MappedFile& file,
+			                 TransportCatalogue::TransportCatalogue& catalog,
+			                 TransportCatalogue::transport_router::TransportRouter& router);
+
+	} //flat_base
+
+} //serialization
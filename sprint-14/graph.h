@@ -2,7 +2,10 @@
 
 #include "ranges.h"
 
+#include <cassert>
 #include <cstdlib>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
 namespace graph {
@@ -17,6 +20,14 @@ namespace graph {
         Weight weight;
     };
 
+    // Outgoing edge as stored in a frozen graph
+    template <typename Weight>
+    struct OutgoingEdge {
+        VertexId to;
+        Weight weight;
+        EdgeId id;
+    };
+
     template <typename Weight>
     class DirectedWeightedGraph {
     private:
@@ -26,17 +37,35 @@ namespace graph {
     public:
         DirectedWeightedGraph() = default;
         explicit DirectedWeightedGraph(size_t vertex_count);
+        // Builds a frozen graph from edges listed by id, e.g. read from a serialized base; they may refer to
+        // memory kept alive by the caller, e.g. a mapped base, and are then used in place
+        DirectedWeightedGraph(size_t vertex_count, ranges::StoredArray<Edge<Weight>> edges);
         void SetVertexCount(size_t vertex_count);
         EdgeId AddEdge(const Edge<Weight>& edge);
+        // Packs the incidence lists into compressed sparse rows; the graph can't be changed afterwards
+        void Freeze();
+        bool IsFrozen() const;
 
         size_t GetVertexCount() const;
         size_t GetEdgeCount() const;
         const Edge<Weight>& GetEdge(EdgeId edge_id) const;
         IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
 
+        // Calls func(const OutgoingEdge<Weight>&) for every edge leaving vertex; a frozen graph reads them sequentially
+        template <typename Func>
+        void ForEachOutgoingEdge(VertexId vertex, Func func) const;
+
     private:
-        std::vector<Edge<Weight>> edges_;
+        ranges::StoredArray<Edge<Weight>> edges_;
         std::vector<IncidenceList> incidence_lists_; //ñîäåðæèò âåêòîðà ID ðåáåð
+
+        // Frozen form: edges leaving vertex v are [offsets_[v], offsets_[v + 1]) in both arrays
+        bool frozen_ = false;
+        std::vector<size_t> offsets_;
+        IncidenceList incident_edge_ids_;
+        std::vector<OutgoingEdge<Weight>> outgoing_edges_;
+
+        void BuildRows(size_t vertex_count);
     };
 
     template <typename Weight>
@@ -44,22 +73,78 @@ namespace graph {
         : incidence_lists_(vertex_count) {
     }
 
+    template <typename Weight>
+    DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count, ranges::StoredArray<Edge<Weight>> edges)
+        : edges_(std::move(edges)) {
+        for (const Edge<Weight>& edge : edges_) {
+            if (edge.from >= vertex_count || edge.to >= vertex_count) {
+                throw std::out_of_range("Vertex is out of range");
+            }
+        }
+        BuildRows(vertex_count);
+    }
+
     template <typename Weight>
     void DirectedWeightedGraph<Weight>::SetVertexCount(size_t vertex_count) {
+        if (frozen_) {
+            throw std::logic_error("Graph is frozen");
+        }
         incidence_lists_.resize(vertex_count);
     }
 
     template <typename Weight>
     EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
-        edges_.push_back(edge);
+        if (frozen_) {
+            throw std::logic_error("Graph is frozen");
+        }
+        if (edge.from >= incidence_lists_.size()) {
+            throw std::out_of_range("Vertex is out of range");
+        }
+        edges_.GetMutable().push_back(edge);
         const EdgeId id = edges_.size() - 1;
-        incidence_lists_.at(edge.from).push_back(id);
+        incidence_lists_[edge.from].push_back(id);
         return id;
     }
 
+    template <typename Weight>
+    void DirectedWeightedGraph<Weight>::Freeze() {
+        if (frozen_) {
+            return;
+        }
+        const size_t vertex_count = incidence_lists_.size();
+        std::vector<IncidenceList>().swap(incidence_lists_);
+        BuildRows(vertex_count);
+    }
+
+    // Counting sort of the edges by `from`; edges of one vertex keep the order of their ids
+    template <typename Weight>
+    void DirectedWeightedGraph<Weight>::BuildRows(size_t vertex_count) {
+        offsets_.assign(vertex_count + 1, 0);
+        for (const Edge<Weight>& edge : edges_) {
+            ++offsets_[edge.from + 1];
+        }
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            offsets_[vertex + 1] += offsets_[vertex];
+        }
+        incident_edge_ids_.resize(edges_.size());
+        outgoing_edges_.resize(edges_.size());
+        std::vector<size_t> next_slot(offsets_.begin(), offsets_.end() - 1);
+        for (EdgeId id = 0; id < edges_.size(); ++id) {
+            const size_t slot = next_slot[edges_[id].from]++;
+            incident_edge_ids_[slot] = id;
+            outgoing_edges_[slot] = { edges_[id].to, edges_[id].weight, id };
+        }
+        frozen_ = true;
+    }
+
+    template <typename Weight>
+    bool DirectedWeightedGraph<Weight>::IsFrozen() const {
+        return frozen_;
+    }
+
     template <typename Weight>
     size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
-        return incidence_lists_.size();
+        return frozen_ ? offsets_.size() - 1 : incidence_lists_.size();
     }
 
     template <typename Weight>
@@ -69,12 +154,33 @@ namespace graph {
 
     template <typename Weight>
     const Edge<Weight>& DirectedWeightedGraph<Weight>::GetEdge(EdgeId edge_id) const {
-        return edges_.at(edge_id);
+        assert(edge_id < edges_.size());
+        return edges_[edge_id];
     }
 
     template <typename Weight>
     typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
         DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
-        return ranges::AsRange(incidence_lists_.at(vertex));
+        assert(vertex < GetVertexCount());
+        if (frozen_) {
+            return { incident_edge_ids_.begin() + offsets_[vertex], incident_edge_ids_.begin() + offsets_[vertex + 1] };
+        }
+        return ranges::AsRange(incidence_lists_[vertex]);
+    }
+
+    template <typename Weight>
+    template <typename Func>
+    void DirectedWeightedGraph<Weight>::ForEachOutgoingEdge(VertexId vertex, Func func) const {
+        assert(vertex < GetVertexCount());
+        if (frozen_) {
+            for (size_t i = offsets_[vertex]; i < offsets_[vertex + 1]; ++i) {
+                func(outgoing_edges_[i]);
+            }
+            return;
+        }
+        for (const EdgeId id : incidence_lists_[vertex]) {
+            const Edge<Weight>& edge = edges_[id];
+            func(OutgoingEdge<Weight>{ edge.to, edge.weight, id });
+        }
     }
 }  // namespace graph
\ No newline at end of file
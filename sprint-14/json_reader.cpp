@@ -69,6 +69,16 @@ namespace json_reader {
         return res;
     }
 
+    RequestStatTile MakeRequestStatTile(const json::Dict& dic) {
+        RequestStatTile res;
+        res.id = dic.at("id"s).AsInt();
+        res.type = "Tile"s;
+        res.tile.zoom = dic.at("zoom"s).AsInt();
+        res.tile.x = dic.at("x"s).AsInt();
+        res.tile.y = dic.at("y"s).AsInt();
+        return res;
+    }
+
     json::Node MakeNodeForError(int id) {
         return json::Builder{}.StartDict()
             .Key("request_id"s).Value(id)
@@ -94,9 +104,9 @@ namespace json_reader {
             .EndDict().Build();
     }
 
-    json::Node MakeNodeForStop(int id, std::set<std::string>&& buses_) {
+    json::Node MakeNodeForStop(int id, json::Array&& buses_) {
         return json::Builder{}.StartDict()
-            .Key("buses"s).Value(json::Array{ buses_.begin(), buses_.end() })
+            .Key("buses"s).Value(std::move(buses_))
             .Key("request_id"s).Value(id)
             .EndDict().Build();
     }
@@ -146,11 +156,58 @@ namespace json_reader {
     }
 
     TransportCatalogue::BusTimesSettings GetRenderSettingsForRouter(const json::Dict& dic) {
-        return { dic.at("bus_wait_time"s).AsDouble(), (dic.at("bus_velocity"s).AsDouble() * 1000.0) / 60.0 };
+        TransportCatalogue::BusTimesSettings settings{ dic.at("bus_wait_time"s).AsDouble(), (dic.at("bus_velocity"s).AsDouble() * 1000.0) / 60.0 };
+        if (dic.count("graph_model"s)) {
+            const std::string& model = dic.at("graph_model"s).AsString();
+            if (model == "stop_pairs"s) {
+                settings.graph_model_ = TransportCatalogue::GraphModel::STOP_PAIRS;
+            }
+            else if (model == "transfer_nodes"s) {
+                settings.graph_model_ = TransportCatalogue::GraphModel::TRANSFER_NODES;
+            }
+            else {
+                throw std::invalid_argument("Unknown graph_model: "s + model);
+            }
+        }
+        return settings;
+    }
+
+    graph::RouterMode GetRouterMode(const json::Dict& dic) {
+        if (dic.count("router_mode"s) == 0) {
+            return graph::RouterMode::DIJKSTRA;
+        }
+        const std::string& mode = dic.at("router_mode"s).AsString();
+        if (mode == "all_pairs"s) {
+            return graph::RouterMode::ALL_PAIRS;
+        }
+        else if (mode == "dijkstra"s) {
+            return graph::RouterMode::DIJKSTRA;
+        }
+        else if (mode == "cached_dijkstra"s) {
+            return graph::RouterMode::CACHED_DIJKSTRA;
+        }
+        else if (mode == "contraction_hierarchy"s) {
+            return graph::RouterMode::CONTRACTION_HIERARCHY;
+        }
+        else if (mode == "blocked_all_pairs"s) {
+            return graph::RouterMode::BLOCKED_ALL_PAIRS;
+        }
+        throw std::invalid_argument("Unknown router_mode: "s + mode);
     }
 
     serialization::SerializationSettings GetSettingsForSerializator(const json::Dict& dic) {
-        return { dic.at("file"s).AsString() };
+        serialization::SerializationSettings settings{ dic.at("file"s).AsString() };
+        // Only make_base needs the format: process_requests recognizes a flat base by its header
+        if (dic.count("format"s)) {
+            const std::string& format = dic.at("format"s).AsString();
+            if (format == "flat"s) {
+                settings.format = serialization::BaseFormat::FLAT;
+            }
+            else if (format != "protobuf"s) {
+                throw std::invalid_argument("Unknown format: "s + format);
+            }
+        }
+        return settings;
     }
 
     json::Node MakeDictFromItem(Item* item) {
@@ -8,6 +8,7 @@
 #include "svg.h"
 #include "domain.h"
 #include "serialization.h"
+#include "router.h"
 
 #include <deque>
 #include <string_view>
@@ -32,6 +33,11 @@ namespace json_reader {
         int id = 0;
     };
 
+    // Part of the map: {"type": "Tile", "zoom": z, "x": x, "y": y}, see rendering::TileId
+    struct RequestStatTile : public RequestStat {
+        rendering::TileId tile;
+    };
+
     struct RequestStop : public Request {
         std::string name;
         geo::Coordinates coordinates;
@@ -75,13 +81,15 @@ namespace json_reader {
     RequestBus MakeRequestBus(const json::Dict& dic);
     RequestStat MakeRequestStat(const json::Dict& dic);
     RequestStatRoute MakeRequestStatRoute(const json::Dict& dic);
+    RequestStatTile MakeRequestStatTile(const json::Dict& dic);
     json::Node MakeNodeForError(int id);
-    json::Node MakeNodeForStop(int id, std::set<std::string>&& buses_);
+    json::Node MakeNodeForStop(int id, json::Array&& buses_);
     json::Node MakeNodeForRoute(int id, double time, json::Array&& items);
     json::Node MakeNodeForBus(int id, TransportCatalogue::detail::InformationBus&& inform);
     svg::Color ColorFromNode(const json::Node& node);
     RenderSettings GetRenderSettingsForMap(const json::Dict& dic);
     TransportCatalogue::BusTimesSettings GetRenderSettingsForRouter(const json::Dict& dic);
+    graph::RouterMode GetRouterMode(const json::Dict& dic);
     serialization::SerializationSettings GetSettingsForSerializator(const json::Dict& dic);
     json::Node MakeDictFromItem(Item* item);
 
@@ -1,11 +1,23 @@
 #include "map_renderer.h"
 
+#include <cmath>
+#include <stdexcept>
+#include <unordered_map>
+
 using namespace std;
 
 namespace rendering {
 
+    // Polyline points closer than this to the simplified line are dropped, in pixels of the tile
+    static constexpr double TILE_SIMPLIFY_TOLERANCE = 0.5;
+    // Label boxes are estimated with no font metrics: a character is taken as wide as the font size,
+    // and descenders as going below the baseline by a third of it
+    static constexpr double LABEL_DESCENT = 1.0 / 3.0;
+
     void MapRenderer::SetSettings(const RenderSettings& settings) {
         settings_ = settings;
+        map_.reset();
+        tiles_.reset();
     }
 
     RenderSettings MapRenderer::GetSettings() const {
@@ -16,124 +28,495 @@ namespace rendering {
         return std::abs(value) < EPSILON;
     }
 
+    namespace {
+
+        struct Bounds {
+            double min_lat = 0.0;
+            double max_lat = 0.0;
+            double min_lng = 0.0;
+            double max_lng = 0.0;
+        };
+
+        // Accumulators per array, updated independently, so that the compiler keeps them in one vector
+        // register and compares BOUNDS_LANES coordinates per instruction
+        static constexpr size_t BOUNDS_LANES = 4;
+
+        // Minimum and maximum of both arrays in a single pass; coords must not be empty
+        Bounds ComputeBounds(const CoordinatesArrays& coords) {
+            const size_t count = coords.lat.size();
+            const double* lat = coords.lat.data();
+            const double* lng = coords.lng.data();
+            double min_lat[BOUNDS_LANES], max_lat[BOUNDS_LANES], min_lng[BOUNDS_LANES], max_lng[BOUNDS_LANES];
+            for (size_t lane = 0; lane < BOUNDS_LANES; ++lane) {
+                min_lat[lane] = max_lat[lane] = lat[0];
+                min_lng[lane] = max_lng[lane] = lng[0];
+            }
+            size_t i = 0;
+            for (; i + BOUNDS_LANES <= count; i += BOUNDS_LANES) {
+                for (size_t lane = 0; lane < BOUNDS_LANES; ++lane) {
+                    min_lat[lane] = lat[i + lane] < min_lat[lane] ? lat[i + lane] : min_lat[lane];
+                    max_lat[lane] = max_lat[lane] < lat[i + lane] ? lat[i + lane] : max_lat[lane];
+                    min_lng[lane] = lng[i + lane] < min_lng[lane] ? lng[i + lane] : min_lng[lane];
+                    max_lng[lane] = max_lng[lane] < lng[i + lane] ? lng[i + lane] : max_lng[lane];
+                }
+            }
+            for (; i < count; ++i) {
+                min_lat[0] = std::min(min_lat[0], lat[i]);
+                max_lat[0] = std::max(max_lat[0], lat[i]);
+                min_lng[0] = std::min(min_lng[0], lng[i]);
+                max_lng[0] = std::max(max_lng[0], lng[i]);
+            }
+            return { *std::min_element(min_lat, min_lat + BOUNDS_LANES), *std::max_element(max_lat, max_lat + BOUNDS_LANES),
+                *std::min_element(min_lng, min_lng + BOUNDS_LANES), *std::max_element(max_lng, max_lng + BOUNDS_LANES) };
+        }
+
+    } // namespace
+
+    SphereProjector::SphereProjector(const CoordinatesArrays& coords, double max_width, double max_height, double padding)
+        : padding_(padding) {
+        if (coords.lat.empty()) {
+            return;
+        }
+
+        const Bounds bounds = ComputeBounds(coords);
+        min_lon_ = bounds.min_lng;
+        const double max_lon = bounds.max_lng;
+        const double min_lat = bounds.min_lat;
+        max_lat_ = bounds.max_lat;
+
+        std::optional<double> width_zoom;
+        if (!IsZero(max_lon - min_lon_)) {
+            width_zoom = static_cast<double>((max_width - 2.0 * static_cast<double>(padding)) / (max_lon - min_lon_));
+        }
+
+        std::optional<double> height_zoom;
+        if (!IsZero(max_lat_ - min_lat)) {
+            height_zoom = static_cast<double>((max_height - 2.0 * static_cast<double>(padding)) / (max_lat_ - min_lat));
+        }
+
+        if (width_zoom && height_zoom) {
+            zoom_coeff_ = std::min(*width_zoom, *height_zoom);
+        }
+        else if (width_zoom) {
+            zoom_coeff_ = *width_zoom;
+        }
+        else if (height_zoom) {
+            zoom_coeff_ = *height_zoom;
+        }
+    }
+
     svg::Point SphereProjector::operator()(geo::Coordinates coords) const {
         return { (coords.lng - min_lon_) * zoom_coeff_ + padding_,
                 (max_lat_ - coords.lat) * zoom_coeff_ + padding_ };
     }
 
-    void MapRenderer::Render(std::ostream& out) {
-        set<geo::Coordinates> coords;
-        for (const auto& [k, v] : stops_for_map_) {
-            coords.insert(v->coordinates);
+    void SphereProjector::Project(const CoordinatesArrays& coords, std::vector<svg::Point>& points) const {
+        const size_t count = coords.lat.size();
+        points.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            points[i].x = (coords.lng[i] - min_lon_) * zoom_coeff_ + padding_;
+            points[i].y = (max_lat_ - coords.lat[i]) * zoom_coeff_ + padding_;
+        }
+    }
+
+    MapRenderer::MapLayout MapRenderer::MakeLayout(const std::set<const TransportCatalogue::Bus*, TransportCatalogue::detail::BusHasher>& buses,
+        const std::map<std::string_view, const TransportCatalogue::Stop*>& stops) const {
+        MapLayout layout;
+        CoordinatesArrays coords;
+        coords.lat.reserve(stops.size());
+        coords.lng.reserve(stops.size());
+        layout.stop_names.reserve(stops.size());
+        unordered_map<TransportCatalogue::StopId, uint32_t> stop_indexes(stops.size());
+        for (const auto& [name, stop] : stops) {
+            stop_indexes[stop->id] = static_cast<uint32_t>(layout.stop_names.size());
+            coords.lat.push_back(stop->coordinates.lat);
+            coords.lng.push_back(stop->coordinates.lng);
+            layout.stop_names.push_back(stop->name_stop);
+        }
+        SphereProjector(coords, settings_.width, settings_.height, settings_.padding).Project(coords, layout.points);
+
+        // A route with no stops is drawn as an empty polyline and doesn't take a color
+        int color_index = 0;
+        layout.routes.reserve(buses.size());
+        for (const auto& bus : buses) {
+            MapLayout::Route route;
+            route.name = bus->name_bus;
+            route.color = settings_.color_palette[color_index % settings_.color_palette.size()];
+            route.path.reserve(bus->looping ? bus->route.size() : 2 * bus->route.size());
+            for (TransportCatalogue::StopId stop : bus->route) {
+                route.path.push_back(stop_indexes.at(stop));
+            }
+            if (!bus->route.empty()) {
+                const size_t size = bus->route.size();
+                if (!bus->looping) {
+                    for (size_t i = size - 1; i-- > 0;) {
+                        route.path.push_back(route.path[i]);
+                    }
+                }
+                route.label_stops.push_back(route.path.front());
+                if (bus->route[0] != bus->route[size - 1]) {
+                    route.label_stops.push_back(route.path[size - 1]);
+                }
+                ++color_index;
+            }
+            layout.routes.push_back(std::move(route));
         }
-        SphereProjector projector(coords.begin(), coords.end(), settings_.width, settings_.height, settings_.padding);
-        RenderBusRoutes(projector);
-        RenderRoutesNames(projector);
-        RenderStops(projector);
-        RenderStopsNames(projector);
-        document_render_.Render(out);
+        return layout;
+    }
+
+    svg::Document MapRenderer::BuildDocument() const {
+        svg::Document document_render;
+        RenderLayout(MakeLayout(bus_for_map_, stops_for_map_), document_render);
+        return document_render;
+    }
+
+    void MapRenderer::RenderLayout(const MapLayout& layout, svg::Document& document_render) const {
+        RenderBusRoutes(layout, document_render);
+        RenderRoutesNames(layout, document_render);
+        RenderStops(layout, document_render);
+        RenderStopsNames(layout, document_render);
+    }
+
+    void MapRenderer::Render(std::ostream& out) const {
+        BuildDocument().Render(out);
     }
 
     void MapRenderer::SetDateForMap(BusesAndStops&& info) {
         bus_for_map_ = std::move(info.first);
         stops_for_map_ = std::move(info.second);
+        map_.reset();
+        tiles_.reset();
     }
 
-    void MapRenderer::RenderBusRoutes(const rendering::SphereProjector& projector) {
-        int color_index = 0;
-        for (const auto& route : bus_for_map_) {
-            svg::Polyline line;
-            vector<string_view> stops(route->stops_for_bus_.begin(), route->stops_for_bus_.end());
-            if (!route->looping) {
-                stops.insert(stops.end(), next(route->stops_for_bus_.rbegin()), route->stops_for_bus_.rend());
+    const std::string& MapRenderer::GetMap() {
+        if (!map_) {
+            // Cached only once rendered in full, so a failed render is retried rather than kept empty
+            std::string map;
+            BuildDocument().Render(map, svg::Escaping::JSON);
+            map_ = std::move(map);
+        }
+        return *map_;
+    }
+
+    bool MapRenderer::HasMap() const {
+        return map_.has_value();
+    }
+
+    bool MapRenderer::CanRender() const {
+        return !settings_.color_palette.empty();
+    }
+
+    void MapRenderer::RestoreMap(std::string map) {
+        map_ = std::move(map);
+    }
+
+    svg::Polyline MapRenderer::MakeRouteLine(const svg::Color& color) const {
+        svg::Polyline line;
+        line.SetFillColor("none"s);
+        line.SetStrokeColor(color);
+        line.SetStrokeLineCap(svg::StrokeLineCap::ROUND);
+        line.SetStrokeWidth(settings_.line_width);
+        line.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+        return line;
+    }
+
+    void MapRenderer::AddBusLabel(svg::Document& document_render, std::string_view name, const svg::Color& color, svg::Point position) const {
+        svg::Text background_, text;
+        //äåëàåì ïîäëîæêó
+        background_.SetFontFamily("Verdana"s)
+            .SetOffset({ settings_.bus_label_offset[0], settings_.bus_label_offset[1] })
+            .SetFontSize(settings_.bus_label_font_size)
+            .SetFontWeight("bold"s)
+            .SetStrokeColor(settings_.underlayer_color)
+            .SetFillColor(settings_.underlayer_color)
+            .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
+            .SetStrokeWidth(settings_.underlayer_width)
+            .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND)
+            .SetData(string(name))
+            .SetPosition(position);
+        document_render.Add(background_);
+        //äåëàåì òåêñò
+        text.SetFontFamily("Verdana"s)
+            .SetOffset({ settings_.bus_label_offset[0], settings_.bus_label_offset[1] })
+            .SetFontSize(settings_.bus_label_font_size)
+            .SetFontWeight("bold"s)
+            .SetFillColor(color)
+            .SetData(string(name))
+            .SetPosition(position);
+        document_render.Add(text);
+    }
+
+    void MapRenderer::AddStop(svg::Document& document_render, svg::Point position) const {
+        svg::Circle circle;
+        circle.SetRadius(settings_.stop_radius)
+            .SetFillColor("white"s)
+            .SetCenter(position);
+        document_render.Add(circle);
+    }
+
+    void MapRenderer::AddStopLabel(svg::Document& document_render, std::string_view name, svg::Point position) const {
+        svg::Text text, background_;
+        //äåëàåì ïîäëîæêó
+        background_.SetFontFamily("Verdana"s)
+            .SetOffset({ settings_.stop_label_offset[0], settings_.stop_label_offset[1] })
+            .SetFontSize(settings_.stop_label_font_size)
+            .SetStrokeColor(settings_.underlayer_color)
+            .SetFillColor(settings_.underlayer_color)
+            .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
+            .SetStrokeWidth(settings_.underlayer_width)
+            .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND)
+            .SetData(string(name))
+            .SetPosition(position);
+        document_render.Add(background_);
+        //äåëàåì òåêñò
+        text.SetFontFamily("Verdana"s)
+            .SetOffset({ settings_.stop_label_offset[0], settings_.stop_label_offset[1] })
+            .SetFontSize(settings_.stop_label_font_size)
+            .SetFillColor("black"s)
+            .SetData(string(name))
+            .SetPosition(position);
+        document_render.Add(text);
+    }
+
+    void MapRenderer::RenderBusRoutes(const MapLayout& layout, svg::Document& document_render) const {
+        for (const auto& route : layout.routes) {
+            svg::Polyline line = MakeRouteLine(route.color);
+            for (uint32_t stop : route.path) {
+                line.AddPoint(layout.points[stop]);
             }
-            for (const auto& s : stops) {
-                line.AddPoint(projector(stops_for_map_.at(s)->coordinates));
+            document_render.Add(std::move(line));
+        }
+    }
+
+    void MapRenderer::RenderRoutesNames(const MapLayout& layout, svg::Document& document_render) const {
+        for (const auto& route : layout.routes) {
+            for (uint32_t stop : route.label_stops) {
+                AddBusLabel(document_render, route.name, route.color, layout.points[stop]);
             }
-            line.SetFillColor("none"s);
-            line.SetStrokeColor(settings_.color_palette[color_index % settings_.color_palette.size()]);
-            line.SetStrokeLineCap(svg::StrokeLineCap::ROUND);
-            line.SetStrokeWidth(settings_.line_width);
-            line.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
-            if (stops.size() != 0) {
-                color_index++;
+        }
+    }
+
+    void MapRenderer::RenderStops(const MapLayout& layout, svg::Document& document_render) const {
+        for (const svg::Point& point : layout.points) {
+            AddStop(document_render, point);
+        }
+    }
+
+    void MapRenderer::RenderStopsNames(const MapLayout& layout, svg::Document& document_render) const {
+        for (size_t i = 0; i < layout.points.size(); ++i) {
+            AddStopLabel(document_render, layout.stop_names[i], layout.points[i]);
+        }
+    }
+
+    namespace {
+
+        size_t CountCodePoints(std::string_view text) {
+            return std::count_if(text.begin(), text.end(), [](char c) {
+                return (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+            });
+        }
+
+        Rect LabelReach(std::string_view name, const double offset[2], int font_size, double underlayer_width) {
+            const double size = static_cast<double>(font_size);
+            const double stroke = underlayer_width / 2.0;
+            return { offset[0] - stroke, offset[1] - size - stroke,
+                offset[0] + size * static_cast<double>(CountCodePoints(name)) + stroke, offset[1] + size * LABEL_DESCENT + stroke };
+        }
+
+        Rect Union(const Rect& lhs, const Rect& rhs) {
+            return { std::min(lhs.min_x, rhs.min_x), std::min(lhs.min_y, rhs.min_y),
+                std::max(lhs.max_x, rhs.max_x), std::max(lhs.max_y, rhs.max_y) };
+        }
+
+        // Box of something drawn at point, reaching as far as reach pixels on a map scaled scale times
+        Rect BoxAround(svg::Point point, const Rect& reach, double scale) {
+            return { point.x + reach.min_x / scale, point.y + reach.min_y / scale,
+                point.x + reach.max_x / scale, point.y + reach.max_y / scale };
+        }
+
+        // Area whose points have something reaching into area
+        Rect Grow(const Rect& area, const Rect& reach, double scale) {
+            return { area.min_x - reach.max_x / scale, area.min_y - reach.max_y / scale,
+                area.max_x - reach.min_x / scale, area.max_y - reach.min_y / scale };
+        }
+
+        double DistanceToSegment(svg::Point point, svg::Point from, svg::Point to) {
+            const double dx = to.x - from.x;
+            const double dy = to.y - from.y;
+            const double length = dx * dx + dy * dy;
+            double t = 0.0;
+            if (length > 0.0) {
+                t = std::clamp(((point.x - from.x) * dx + (point.y - from.y) * dy) / length, 0.0, 1.0);
             }
-            document_render_.Add(line);
+            return std::hypot(point.x - from.x - t * dx, point.y - from.y - t * dy);
+        }
 
+        // Douglas-Peucker: keeps the points that deviate from the simplified line by more than tolerance
+        vector<svg::Point> Simplify(const vector<svg::Point>& points, double tolerance) {
+            if (points.size() < 3) {
+                return points;
+            }
+            vector<bool> keep(points.size(), false);
+            keep.front() = true;
+            keep.back() = true;
+            vector<pair<size_t, size_t>> ranges = { { 0, points.size() - 1 } };
+            while (!ranges.empty()) {
+                const auto [first, last] = ranges.back();
+                ranges.pop_back();
+                double max_distance = 0.0;
+                size_t farthest = first;
+                for (size_t i = first + 1; i < last; ++i) {
+                    const double distance = DistanceToSegment(points[i], points[first], points[last]);
+                    if (distance > max_distance) {
+                        max_distance = distance;
+                        farthest = i;
+                    }
+                }
+                if (max_distance > tolerance) {
+                    keep[farthest] = true;
+                    ranges.push_back({ first, farthest });
+                    ranges.push_back({ farthest, last });
+                }
+            }
+            vector<svg::Point> result;
+            for (size_t i = 0; i < points.size(); ++i) {
+                if (keep[i]) {
+                    result.push_back(points[i]);
+                }
+            }
+            return result;
         }
+
+    } // namespace
+
+    Rect MapRenderer::BusLabelReach(std::string_view name) const {
+        return LabelReach(name, settings_.bus_label_offset, settings_.bus_label_font_size, settings_.underlayer_width);
     }
 
-    void MapRenderer::RenderRoutesNames(const SphereProjector& projector) {
-        int color_index = 0;
-        svg::Text background_, text;
+    Rect MapRenderer::StopLabelReach(std::string_view name) const {
+        return LabelReach(name, settings_.stop_label_offset, settings_.stop_label_font_size, settings_.underlayer_width);
+    }
 
-        for (const auto& route : bus_for_map_) {
-            vector<string_view> stops = { route->stops_for_bus_.front() };
-            if (route->stops_for_bus_.front() != route->stops_for_bus_.back()) {
-                stops.push_back(route->stops_for_bus_.back());
-            }
-            for (const auto& s : stops) {
-                //äåëàåì ïîäëîæêó
-                background_.SetFontFamily("Verdana"s)
-                    .SetOffset({ settings_.bus_label_offset[0], settings_.bus_label_offset[1] })
-                    .SetFontSize(settings_.bus_label_font_size)
-                    .SetFontWeight("bold"s)
-                    .SetStrokeColor(settings_.underlayer_color)
-                    .SetFillColor(settings_.underlayer_color)
-                    .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
-                    .SetStrokeWidth(settings_.underlayer_width)
-                    .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND)
-                    .SetData(route->name_bus)
-                    .SetPosition(projector(stops_for_map_.at(s)->coordinates));
-                document_render_.Add(background_);
-                //äåëàåì òåêñò
-                text.SetFontFamily("Verdana"s)
-                    .SetOffset({ settings_.bus_label_offset[0], settings_.bus_label_offset[1] })
-                    .SetFontSize(settings_.bus_label_font_size)
-                    .SetFontWeight("bold"s)
-                    .SetFillColor(settings_.color_palette[color_index % settings_.color_palette.size()])
-                    .SetData(route->name_bus)
-                    .SetPosition(projector(stops_for_map_.at(s)->coordinates));
-                document_render_.Add(text);
-            }
-            color_index++;
-        }
-    }
-
-    void MapRenderer::RenderStops(const SphereProjector& projector) {
-        svg::Circle circle;
-        for (const auto& [_, stop] : stops_for_map_) {
-            circle.SetRadius(settings_.stop_radius)
-                .SetFillColor("white"s)
-                .SetCenter(projector(stop->coordinates));
-            document_render_.Add(circle);
+    void MapRenderer::PrepareTiles(const BusesAndStops& info) {
+        const auto& [buses, stops] = info;
+        TileSource source;
+        source.layout = MakeLayout(buses, stops);
+
+        const Rect circle_reach = { -settings_.stop_radius, -settings_.stop_radius, settings_.stop_radius, settings_.stop_radius };
+        source.max_stop_reach = circle_reach;
+        for (string_view name : source.layout.stop_names) {
+            source.max_stop_reach = Union(source.max_stop_reach, StopLabelReach(name));
         }
+
+        const Rect no_reach;
+        vector<Rect> segment_boxes, bus_label_boxes, stop_boxes;
+        source.max_bus_label_reach = no_reach;
+        for (uint32_t i = 0; i < source.layout.routes.size(); ++i) {
+            const MapLayout::Route& route = source.layout.routes[i];
+            for (uint32_t j = 0; j + 1 < route.path.size(); ++j) {
+                const svg::Point from = source.layout.points[route.path[j]];
+                const svg::Point to = source.layout.points[route.path[j + 1]];
+                source.segments.push_back({ i, j });
+                segment_boxes.push_back({ min(from.x, to.x), min(from.y, to.y), max(from.x, to.x), max(from.y, to.y) });
+            }
+            for (uint32_t j = 0; j < route.label_stops.size(); ++j) {
+                source.bus_labels.push_back({ i, j });
+                bus_label_boxes.push_back(BoxAround(source.layout.points[route.label_stops[j]], no_reach, 1.0));
+            }
+            source.max_bus_label_reach = Union(source.max_bus_label_reach, BusLabelReach(route.name));
+        }
+        for (const svg::Point& point : source.layout.points) {
+            stop_boxes.push_back(BoxAround(point, no_reach, 1.0));
+        }
+
+        const Rect bounds = { 0.0, 0.0, settings_.width, settings_.height };
+        source.segment_grid = SpatialGrid(bounds, std::move(segment_boxes));
+        source.bus_label_grid = SpatialGrid(bounds, std::move(bus_label_boxes));
+        source.stop_grid = SpatialGrid(bounds, std::move(stop_boxes));
+        tiles_ = std::move(source);
     }
 
-    void MapRenderer::RenderStopsNames(const SphereProjector& projector) {
-        svg::Text text, background_;
-        for (const auto& [k, v] : stops_for_map_) {
-            //äåëàåì ïîäëîæêó
-            background_.SetFontFamily("Verdana"s)
-                .SetOffset({ settings_.stop_label_offset[0], settings_.stop_label_offset[1] })
-                .SetFontSize(settings_.stop_label_font_size)
-                .SetStrokeColor(settings_.underlayer_color)
-                .SetFillColor(settings_.underlayer_color)
-                .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
-                .SetStrokeWidth(settings_.underlayer_width)
-                .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND)
-                .SetData(v->name_stop)
-                .SetPosition(projector(v->coordinates));
-            document_render_.Add(background_);
-            //äåëàåì òåêñò
-            text.SetFontFamily("Verdana"s)
-                .SetOffset({ settings_.stop_label_offset[0], settings_.stop_label_offset[1] })
-                .SetFontSize(settings_.stop_label_font_size)
-                .SetFillColor("black"s)
-                .SetData(v->name_stop)
-                .SetPosition(projector(v->coordinates));
-            document_render_.Add(text);
-        }
-    }
-
-}//namespace rendering
\ No newline at end of file
+    bool MapRenderer::HasTiles() const {
+        return tiles_.has_value();
+    }
+
+    void MapRenderer::RenderTile(TileId tile, std::string& out, svg::Escaping escaping) const {
+        if (!tiles_) {
+            throw std::logic_error("tiles are not prepared"s);
+        }
+        if (tile.zoom < 0 || tile.zoom > MAX_TILE_ZOOM) {
+            throw std::out_of_range("no such zoom level"s);
+        }
+        const int tile_count = 1 << tile.zoom;
+        if (tile.x < 0 || tile.x >= tile_count || tile.y < 0 || tile.y >= tile_count) {
+            throw std::out_of_range("no such tile"s);
+        }
+        const TileSource& source = *tiles_;
+        svg::Document document_render;
+
+        // The only tile of zoom 0 is the whole map, drawn in full with no culling or simplification
+        if (tile.zoom == 0) {
+            RenderLayout(source.layout, document_render);
+            document_render.Render(out, escaping);
+            return;
+        }
+
+        // The tile's part of the whole map, scaled up to the size of the map; line widths, radii
+        // and fonts stay in pixels
+        const double scale = static_cast<double>(tile_count);
+        const double tile_width = settings_.width / scale;
+        const double tile_height = settings_.height / scale;
+        const Rect area = { tile.x * tile_width, tile.y * tile_height, (tile.x + 1) * tile_width, (tile.y + 1) * tile_height };
+        const auto to_tile = [&area, scale](svg::Point point) {
+            return svg::Point{ (point.x - area.min_x) * scale, (point.y - area.min_y) * scale };
+        };
+
+        // Runs of consecutive segments under the tile become polylines of their own
+        const double half_line = settings_.line_width / 2.0;
+        const Rect line_reach = { -half_line, -half_line, half_line, half_line };
+        const vector<uint32_t> segments = source.segment_grid.Query(Grow(area, line_reach, scale));
+        for (size_t first = 0; first < segments.size();) {
+            size_t last = first;
+            while (last + 1 < segments.size() && segments[last + 1] == segments[last] + 1
+                && source.segments[segments[last + 1]].first == source.segments[segments[first]].first) {
+                ++last;
+            }
+            const MapLayout::Route& route = source.layout.routes[source.segments[segments[first]].first];
+            vector<svg::Point> points;
+            for (uint32_t i = source.segments[segments[first]].second; i <= source.segments[segments[last]].second + 1; ++i) {
+                points.push_back(to_tile(source.layout.points[route.path[i]]));
+            }
+            svg::Polyline line = MakeRouteLine(route.color);
+            for (const svg::Point& point : Simplify(points, TILE_SIMPLIFY_TOLERANCE)) {
+                line.AddPoint(point);
+            }
+            document_render.Add(std::move(line));
+            first = last + 1;
+        }
+
+        for (uint32_t label : source.bus_label_grid.Query(Grow(area, source.max_bus_label_reach, scale))) {
+            const auto [route_index, label_index] = source.bus_labels[label];
+            const MapLayout::Route& route = source.layout.routes[route_index];
+            const svg::Point point = source.layout.points[route.label_stops[label_index]];
+            if (BoxAround(point, BusLabelReach(route.name), scale).Intersects(area)) {
+                AddBusLabel(document_render, route.name, route.color, to_tile(point));
+            }
+        }
+
+        const Rect circle_reach = { -settings_.stop_radius, -settings_.stop_radius, settings_.stop_radius, settings_.stop_radius };
+        const vector<uint32_t> stops = source.stop_grid.Query(Grow(area, source.max_stop_reach, scale));
+        for (uint32_t stop : stops) {
+            if (BoxAround(source.layout.points[stop], circle_reach, scale).Intersects(area)) {
+                AddStop(document_render, to_tile(source.layout.points[stop]));
+            }
+        }
+        for (uint32_t stop : stops) {
+            if (BoxAround(source.layout.points[stop], StopLabelReach(source.layout.stop_names[stop]), scale).Intersects(area)) {
+                AddStopLabel(document_render, source.layout.stop_names[stop], to_tile(source.layout.points[stop]));
+            }
+        }
+
+        document_render.Render(out, escaping);
+    }
+
+}//namespace rendering
@@ -8,7 +8,9 @@
 #include "svg.h"
 #include "domain.h"
 #include "geo.h"
+#include "spatial_grid.h"
 #include <string>
+#include <optional>
 
 struct RenderSettings {
     using Color = std::variant<std::monostate, std::string, svg::Rgb, svg::Rgba>;
@@ -31,13 +33,19 @@ namespace rendering {
     inline const double EPSILON = 1e-6;
     bool IsZero(double value);
 
+    // Coordinates kept as separate arrays of latitudes and longitudes, so that they are scanned and projected in bulk
+    struct CoordinatesArrays {
+        std::vector<double> lat;
+        std::vector<double> lng;
+    };
+
     class SphereProjector {
     public:
-        template <typename PointInputIt>
-        SphereProjector(PointInputIt points_begin, PointInputIt points_end, double max_width,
-            double max_height, double padding);
+        SphereProjector(const CoordinatesArrays& coords, double max_width, double max_height, double padding);
 
         svg::Point operator()(geo::Coordinates coords) const;
+        // Projects all coordinates at once; points[i] is the same as operator() gives for the i-th pair
+        void Project(const CoordinatesArrays& coords, std::vector<svg::Point>& points) const;
 
     private:
         double padding_;
@@ -46,68 +54,91 @@ namespace rendering {
         double zoom_coeff_ = 0;
     };
 
+    // Tiles of zoom level z split the map into 2^z x 2^z equal parts, each drawn at the size of the whole map
+    struct TileId {
+        int zoom = 0;
+        int x = 0;
+        int y = 0;
+    };
+
+    inline const int MAX_TILE_ZOOM = 20;
+
     class MapRenderer {
     public:
         using BusesAndStops = std::pair<std::set<const TransportCatalogue::Bus*, TransportCatalogue::detail::BusHasher>, std::map<std::string_view, const TransportCatalogue::Stop*>>;
 
         MapRenderer() = default;
-        void Render(std::ostream& out);
+        // Plain SVG, e.g. for writing to a file
+        void Render(std::ostream& out) const;
         void SetSettings(const RenderSettings&);
         RenderSettings GetSettings() const;
         void SetDateForMap(BusesAndStops&& info);
+        // The SVG escaped for a JSON string, ready to go into a Map response; it is rendered
+        // on the first call and reused until the settings or the data change
+        const std::string& GetMap();
+        bool HasMap() const;
+        // False without a color palette, e.g. when no render settings were given: routes can't be colored then
+        bool CanRender() const;
+        // Takes a map rendered earlier, e.g. read from a serialized base; call after SetSettings
+        void RestoreMap(std::string map);
+        // Projects the stops and indexes everything drawn on the map, for RenderTile; call after SetSettings
+        void PrepareTiles(const BusesAndStops& info);
+        bool HasTiles() const;
+        // Appends the part of the map under the tile, with polylines simplified to the tile's level of detail;
+        // tile 0/0/0 is the same SVG as the whole map.
+        // Safe to call from several threads at once; throws std::out_of_range for a tile outside the map
+        // and std::logic_error if the tiles are not prepared
+        void RenderTile(TileId tile, std::string& out, svg::Escaping escaping = svg::Escaping::NONE) const;
     private:
-        void RenderBusRoutes(const SphereProjector&);
-        void RenderRoutesNames(const SphereProjector&);
-        void RenderStops(const SphereProjector&);
-        void RenderStopsNames(const SphereProjector&);
+        // Stops projected once, in the order of their names, and routes referring to them by index
+        struct MapLayout {
+            struct Route {
+                std::string_view name;
+                svg::Color color;
+                // Indexes into points along the polyline, and the stops labelled with the route's name
+                std::vector<uint32_t> path;
+                std::vector<uint32_t> label_stops;
+            };
+
+            std::vector<svg::Point> points;
+            std::vector<std::string_view> stop_names;
+            std::vector<Route> routes;
+        };
+
+        // The layout indexed by location, for cutting tiles out of it
+        struct TileSource {
+            MapLayout layout;
+            // Segment i goes from layout.routes[route].path[index] to the next point of the path
+            std::vector<std::pair<uint32_t, uint32_t>> segments;
+            // Bus label i is for routes[route].label_stops[index]
+            std::vector<std::pair<uint32_t, uint32_t>> bus_labels;
+            SpatialGrid segment_grid;
+            SpatialGrid bus_label_grid;
+            SpatialGrid stop_grid;
+            // How far labels may reach from their stops, in pixels; stops are queried with this margin
+            Rect max_bus_label_reach;
+            Rect max_stop_reach;
+        };
+
+        MapLayout MakeLayout(const std::set<const TransportCatalogue::Bus*, TransportCatalogue::detail::BusHasher>& buses,
+            const std::map<std::string_view, const TransportCatalogue::Stop*>& stops) const;
+        svg::Document BuildDocument() const;
+        void RenderLayout(const MapLayout&, svg::Document&) const;
+        void RenderBusRoutes(const MapLayout&, svg::Document&) const;
+        void RenderRoutesNames(const MapLayout&, svg::Document&) const;
+        void RenderStops(const MapLayout&, svg::Document&) const;
+        void RenderStopsNames(const MapLayout&, svg::Document&) const;
+        svg::Polyline MakeRouteLine(const svg::Color& color) const;
+        void AddBusLabel(svg::Document&, std::string_view name, const svg::Color& color, svg::Point position) const;
+        void AddStop(svg::Document&, svg::Point position) const;
+        void AddStopLabel(svg::Document&, std::string_view name, svg::Point position) const;
+        Rect BusLabelReach(std::string_view name) const;
+        Rect StopLabelReach(std::string_view name) const;
         RenderSettings settings_;
-        svg::Document document_render_;
+        std::optional<std::string> map_;
+        std::optional<TileSource> tiles_;
         std::set<const TransportCatalogue::Bus*, TransportCatalogue::detail::BusHasher> bus_for_map_;
         std::map<std::string_view, const TransportCatalogue::Stop*> stops_for_map_;
     };
 
-    template <typename PointInputIt>
-    SphereProjector::SphereProjector(PointInputIt points_begin, PointInputIt points_end, double max_width,
-        double max_height, double padding)
-        : padding_(padding) {
-        if (points_begin == points_end) {
-            return;
-        }
-
-        const auto [left_it, right_it]
-            = std::minmax_element(points_begin, points_end, [](auto lhs, auto rhs) {
-            return lhs.lng < rhs.lng;
-                });
-        min_lon_ = left_it->lng;
-        const double max_lon = right_it->lng;
-
-        const auto [bottom_it, top_it]
-            = std::minmax_element(points_begin, points_end, [](auto lhs, auto rhs) {
-            return lhs.lat < rhs.lat;
-                });
-        const double min_lat = bottom_it->lat;
-        max_lat_ = top_it->lat;
-
-        std::optional<double> width_zoom;
-        if (!IsZero(max_lon - min_lon_)) {
-            width_zoom = static_cast<double>((max_width - 2.0 * static_cast<double>(padding)) / (max_lon - min_lon_));
-        }
-
-        std::optional<double> height_zoom;
-        if (!IsZero(max_lat_ - min_lat)) {
-            height_zoom = static_cast<double>((max_height - 2.0 * static_cast<double>(padding)) / (max_lat_ - min_lat));
-        }
-
-        if (width_zoom && height_zoom) {
-            zoom_coeff_ = std::min(*width_zoom, *height_zoom);
-        }
-        else if (width_zoom) {
-            zoom_coeff_ = *width_zoom;
-        }
-        else if (height_zoom) {
-            zoom_coeff_ = *height_zoom;
-        }
-
-    }
-
 }//namespace renderer
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+    // Calls func(i) for every i in [0, count), splitting the range into contiguous blocks between hardware threads.
+    // func must not throw: an exception escaping a worker thread terminates the program
+    template <typename Func>
+    void ParallelFor(size_t count, Func func) {
+        const size_t thread_count = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), count);
+        if (thread_count <= 1) {
+            for (size_t i = 0; i < count; ++i) {
+                func(i);
+            }
+            return;
+        }
+
+        const size_t block_size = (count + thread_count - 1) / thread_count;
+        std::vector<std::thread> threads;
+        threads.reserve(thread_count - 1);
+        for (size_t first = block_size; first < count; first += block_size) {
+            const size_t last = std::min(count, first + block_size);
+            threads.emplace_back([&func, first, last] {
+                for (size_t i = first; i < last; ++i) {
+                    func(i);
+                }
+            });
+        }
+        for (size_t i = 0; i < std::min(count, block_size); ++i) {
+            func(i);
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    // Same as ParallelFor, but threads take chunks of chunk_size indexes on demand, which balances items of uneven cost.
+    // func must not throw either
+    template <typename Func>
+    void ParallelForDynamic(size_t count, size_t chunk_size, Func func) {
+        const size_t chunk_count = (count + chunk_size - 1) / chunk_size;
+        const size_t thread_count = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), chunk_count);
+        std::atomic<size_t> next_chunk = 0;
+        auto worker = [&func, &next_chunk, count, chunk_size] {
+            for (size_t first = next_chunk++ * chunk_size; first < count; first = next_chunk++ * chunk_size) {
+                const size_t last = std::min(count, first + chunk_size);
+                for (size_t i = first; i < last; ++i) {
+                    func(i);
+                }
+            }
+        };
+        std::vector<std::thread> threads;
+        threads.reserve(thread_count > 0 ? thread_count - 1 : 0);
+        for (size_t i = 1; i < thread_count; ++i) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+} //namespace parallel
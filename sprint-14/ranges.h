@@ -1,9 +1,12 @@
 #pragma once
 
+#include <cstddef>
 #include <iterator>
 #include <string_view>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 namespace ranges {
 
@@ -12,6 +15,7 @@ namespace ranges {
     public:
         using ValueType = typename std::iterator_traits<It>::value_type;
 
+        Range() = default;
         Range(It begin, It end)
             : begin_(begin)
             , end_(end) {
@@ -22,10 +26,20 @@ namespace ranges {
         It end() const {
             return end_;
         }
+        size_t size() const {
+            return static_cast<size_t>(std::distance(begin_, end_));
+        }
+        bool empty() const {
+            return begin_ == end_;
+        }
+        // For random access iterators only
+        decltype(auto) operator[](size_t index) const {
+            return begin_[index];
+        }
 
     private:
-        It begin_;
-        It end_;
+        It begin_{};
+        It end_{};
     };
 
     template <typename C>
@@ -33,4 +47,56 @@ namespace ranges {
         return Range{ container.begin(), container.end() };
     }
 
+    // Read-only array that either owns its elements or refers to ones kept alive elsewhere,
+    // e.g. in a mapped base file, so that such an array is used in place instead of copied
+    template <typename T>
+    class StoredArray {
+    public:
+        StoredArray() = default;
+        StoredArray(std::vector<T> values)
+            : values_(std::move(values)) {
+        }
+        StoredArray(Range<const T*> view)
+            : view_(view)
+            , borrowed_(true) {
+        }
+
+        const T* begin() const {
+            return borrowed_ ? view_.begin() : values_.data();
+        }
+        const T* end() const {
+            return borrowed_ ? view_.end() : values_.data() + values_.size();
+        }
+        const T* data() const {
+            return begin();
+        }
+        size_t size() const {
+            return static_cast<size_t>(end() - begin());
+        }
+        bool empty() const {
+            return begin() == end();
+        }
+        const T& operator[](size_t index) const {
+            return begin()[index];
+        }
+        const T& back() const {
+            return end()[-1];
+        }
+
+        // Owned elements for changing, copied first if the array refers to external ones
+        std::vector<T>& GetMutable() {
+            if (borrowed_) {
+                values_.assign(view_.begin(), view_.end());
+                view_ = {};
+                borrowed_ = false;
+            }
+            return values_;
+        }
+
+    private:
+        std::vector<T> values_;
+        Range<const T*> view_;
+        bool borrowed_ = false;
+    };
+
 }  // namespace ranges
\ No newline at end of file
@@ -1,10 +1,18 @@
 #include "request_handler.h"
 #include "router.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <exception>
+#include <sstream>
 
 using namespace std::literals;
 
 namespace RequestHandler {
 
+    // Requests handed to a thread at a time: Route answers vary in cost, so chunks are kept small
+    static constexpr size_t ANSWERS_CHUNK_SIZE = 64;
+
     void RequestHandler::FillRequestsToFill(const std::vector<json::Node>& array_) {
         using namespace json_reader;
         for (const auto& element_ : array_) {
@@ -31,6 +39,9 @@ namespace RequestHandler {
                 else if (element_.AsMap().at("type"s).AsString() == "Route"s) {
                     requests_to_out_.push_back(std::make_unique<RequestStatRoute>(MakeRequestStatRoute(element_.AsMap())));
                 }
+                else if (element_.AsMap().at("type"s).AsString() == "Tile"s) {
+                    requests_to_out_.push_back(std::make_unique<RequestStatTile>(MakeRequestStatTile(element_.AsMap())));
+                }
             }
         }
     }
@@ -85,55 +96,121 @@ namespace RequestHandler {
             }
         }
         SetDistancesInCatalog();
+        catalogue_.Finalize();
     }
 
     void RequestHandler::FillTransportRouter() {
-        router_.FillGraph();
+        // A graph read from the base is used as is
+        if (!router_.HasGraph()) {
+            router_.FillGraph();
+        }
+        router_.BuildRouter();
     }
 
-    void RequestHandler::PrintRequests(std::ostream& out) {
+    void RequestHandler::PrintAnswer(const json_reader::RequestStat& request, std::ostream& out) const {
         using namespace json_reader;
-        bool start_ = false;
-        graph::Router router(router_.GetGraph());
-        out << "["s << std::endl;
-        for (const auto& request_ : requests_to_out_) {
-            if (start_) {
-                out << "," << std::endl;
+        if (request.type == "Stop"s) {
+            auto [has_answer, buses] = catalogue_.GetInformationStop(std::string_view((request.name).value()));
+            json::Node node;
+            if (!has_answer) {
+                node = MakeNodeForError(request.id);
             }
-            if (request_->type == "Stop"s) {
-                auto [has_answer, buses] = catalogue_.GetInformationStop(std::string_view((request_->name).value()));
-                json::Node node;
-                if (!has_answer) {
-                    node = MakeNodeForError(request_->id);
-                }
-                else {
-                    node = MakeNodeForStop(request_->id, std::move(buses));
+            else {
+                json::Array names;
+                for (TransportCatalogue::BusId bus : buses) {
+                    names.push_back(std::string(catalogue_.GetBusesConst()[bus].name_bus));
                 }
-                json::Print(json::Document(node), out);
+                node = MakeNodeForStop(request.id, std::move(names));
             }
-            else if (request_->type == "Bus"s) {
-                TransportCatalogue::detail::InformationBus answer = catalogue_.GetInformationBus(std::string_view((request_->name).value()));
-                json::Node node;
-                if (answer == TransportCatalogue::detail::InformationBus{}) {
-                    node = MakeNodeForError(request_->id);
-                }
-                else {
-                    node = MakeNodeForBus(request_->id, std::move(answer));
-                }
-                json::Print(json::Document(node), out);
+            json::Print(json::Document(node), out);
+        }
+        else if (request.type == "Bus"s) {
+            TransportCatalogue::detail::InformationBus answer = catalogue_.GetInformationBus(std::string_view((request.name).value()));
+            json::Node node;
+            if (answer == TransportCatalogue::detail::InformationBus{}) {
+                node = MakeNodeForError(request.id);
+            }
+            else {
+                node = MakeNodeForBus(request.id, std::move(answer));
+            }
+            json::Print(json::Document(node), out);
+        }
+        else if (request.type == "Route"s) {
+            const RequestStatRoute& route = dynamic_cast<const RequestStatRoute&>(request);
+            json::Node node = router_.GetRouteNode(route.from, route.to, route.id);
+            json::Print(json::Document(node), out);
+        }
+        else if (request.type == "Tile"s) {
+            const RequestStatTile& tile = dynamic_cast<const RequestStatTile&>(request);
+            std::string answer = "{\n\"map\": \""s;
+            try {
+                renderer_.RenderTile(tile.tile, answer, svg::Escaping::JSON);
             }
-            else if (request_->type == "Map"s) {
-                out << "{\n\"map\": \"";
+            catch (const std::out_of_range&) {
+                json::Print(json::Document(MakeNodeForError(tile.id)), out);
+                return;
+            }
+            answer += "\",\n\"request_id\": "s + std::to_string(tile.id) + "\n}"s;
+            out << answer;
+        }
+    }
+
+    void RequestHandler::PrintRequests(std::ostream& out) {
+        using namespace json_reader;
+        // The map doesn't depend on the request, so all Map requests print the renderer's cached SVG
+        const std::string* map = nullptr;
+        const bool has_map = std::any_of(requests_to_out_.begin(), requests_to_out_.end(), [](const auto& request) {
+            return request->type == "Map"s;
+        });
+        if (has_map) {
+            if (!renderer_.HasMap()) {
                 renderer_.SetDateForMap(catalogue_.InfoForMap());
-                renderer_.Render(out);
-                out << "\"," << std::endl << "\"request_id\": "s << request_->id << std::endl << "}";
             }
-            else if (request_->type == "Route"s) {
-                RequestStatRoute* route = dynamic_cast<RequestStatRoute*>(request_.get());
-                json::Node node = router_.GetRouteNode(router, route->from, route->to, route->id);
-                json::Print(json::Document(node), out);
+            map = &renderer_.GetMap();
+        }
+        const bool has_tiles = std::any_of(requests_to_out_.begin(), requests_to_out_.end(), [](const auto& request) {
+            return request->type == "Tile"s;
+        });
+        if (has_tiles && !renderer_.HasTiles()) {
+            renderer_.PrepareTiles(catalogue_.InfoForMap());
+        }
+
+        // Other requests only read the catalogue, the router and the prepared tiles: they are answered in parallel
+        // into separate buffers, which are then printed in the order of the requests
+        std::vector<std::string> answers(requests_to_out_.size());
+        std::vector<std::exception_ptr> errors(requests_to_out_.size());
+        parallel::ParallelForDynamic(requests_to_out_.size(), ANSWERS_CHUNK_SIZE, [this, &answers, &errors](size_t i) {
+            const RequestStat& request = *requests_to_out_[i];
+            if (request.type == "Map"s) {
+                return;
+            }
+            try {
+                std::ostringstream answer;
+                PrintAnswer(request, answer);
+                answers[i] = answer.str();
+            }
+            catch (...) {
+                errors[i] = std::current_exception();
+            }
+        });
+        for (const std::exception_ptr& error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+
+        out << "["s << std::endl;
+        for (size_t i = 0; i < requests_to_out_.size(); ++i) {
+            if (i > 0) {
+                out << "," << std::endl;
+            }
+            if (requests_to_out_[i]->type == "Map"s) {
+                out << "{\n\"map\": \"" << *map;
+                out << "\"," << std::endl << "\"request_id\": "s << requests_to_out_[i]->id << std::endl << "}";
+            }
+            else {
+                out << answers[i];
             }
-            start_ = true;
         }
         out << "\n]"s << std::endl;
     }
@@ -146,6 +223,7 @@ namespace RequestHandler {
     void RequestHandler::FillSettingsRouter(const std::map<std::string, json::Node>& dic) {
         using namespace json_reader;
         router_.SetSettings(GetRenderSettingsForRouter(dic));
+        router_.SetRouterMode(GetRouterMode(dic));
     }
 
     void RequestHandler::FillSettingsSerializator(const std::map<std::string, json::Node>& dic) {
@@ -154,14 +232,32 @@ namespace RequestHandler {
     }
 
     void RequestHandler::SerializeCatalog() {
-        serializator.CatalogueSerialize(catalogue_, router_.GetSettings(), renderer_.GetSettings());
+        // The graph and the router are prepared here once and stored in the base, so requests start without building them
+        FillTransportRouter();
+        // The map is stored pre-rendered only if it can be rendered; otherwise it's left to the first Map request
+        const std::string no_map;
+        if (renderer_.CanRender()) {
+            renderer_.SetDateForMap(catalogue_.InfoForMap());
+        }
+        serializator.CatalogueSerialize(catalogue_, router_, renderer_.GetSettings(), renderer_.CanRender() ? renderer_.GetMap() : no_map);
     }
 
     void RequestHandler::DeserializeCatalog() {
-        transport_catalogue_proto::TransportCatalogue tcp = serializator.CatalogueDeserialize();
-        serializator.FillCatalogue(catalogue_, tcp);
+        if (const auto settings = serializator.LoadFlatBase(catalogue_, router_, base_file_)) {
+            renderer_.SetSettings(serializator.GetRenderSettings(settings->render_settings()));
+            if (!settings->map().empty()) {
+                renderer_.RestoreMap(settings->map());
+            }
+            serializator.FillRouter(catalogue_, router_, *settings);
+            return;
+        }
+        serialization::RouterTables tables;
+        const transport_catalogue_proto::TransportCatalogue tcp = serializator.LoadCatalogue(catalogue_, tables);
         renderer_.SetSettings(serializator.GetRenderSettings(tcp.render_settings()));
-        router_.SetSettings(serializator.GetBusTimesSettings(tcp.time_settings()));
+        if (!tcp.map().empty()) {
+            renderer_.RestoreMap(tcp.map());
+        }
+        serializator.FillRouter(catalogue_, router_, tcp, std::move(tables));
     }
 
 }//namespace RequestHandler
\ No newline at end of file
@@ -7,8 +7,11 @@
 #include "map_renderer.h"
 #include "transport_router.h"
 #include "serialization.h"
+#include "flat_base.h"
 
 #include <deque>
+#include <ostream>
+#include <string>
 #include <string_view>
 
 namespace RequestHandler {
@@ -32,6 +35,8 @@ namespace RequestHandler {
         rendering::MapRenderer& renderer_;
         TransportCatalogue::transport_router::TransportRouter& router_;
         serialization::Serializator serializator;
+        // A loaded flat base, whose arrays the catalogue and the router use in place
+        std::unique_ptr<serialization::flat_base::MappedFile> base_file_;
 
         json::Document document_;
         std::deque<std::unique_ptr<json_reader::Request>> requests_to_fill_;
@@ -44,6 +49,8 @@ namespace RequestHandler {
         void FillSettingsRouter(const std::map<std::string, json::Node>&);
         void FillSettingsSerializator(const std::map<std::string, json::Node>&);
         void SetDistancesInCatalog();
+        // Writes the answer to one Stop, Bus, Route or Tile request; safe to call from several threads at once
+        void PrintAnswer(const json_reader::RequestStat& request, std::ostream& out) const;
     };
 
 }//namespace RequestHandler
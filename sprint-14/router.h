@@ -1,26 +1,59 @@
 #pragma once
 
 #include "graph.h"
+#include "contraction_hierarchy.h"
+#include "parallel.h"
+#include "ranges.h"
 
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <functional>
 #include <iterator>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <queue>
 #include <stdexcept>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace graph {
 
+    enum class RouterMode {
+        ALL_PAIRS,       // all routes are precomputed in the constructor: O(V^3) time, O(V^2) memory
+        DIJKSTRA,        // every BuildRoute runs Dijkstra from the source, stopping at the target
+        CACHED_DIJKSTRA, // full shortest-path trees are computed on demand, the most recently used ones are kept
+        CONTRACTION_HIERARCHY, // shortcuts are precomputed, queries search upward from both ends
+        BLOCKED_ALL_PAIRS, // like ALL_PAIRS, but over flat matrices in tiles relaxed in parallel; floating-point weights only
+    };
+
     template <typename Weight>
     class Router {
     private:
         using Graph = DirectedWeightedGraph<Weight>;
 
     public:
-        explicit Router(const Graph& graph);
+        // All-pairs routes as row-major vertex_count x vertex_count matrices: an infinite weight
+        // marks a missing route, NO_PREV_EDGE the last edge of an empty one. The matrices may refer to
+        // memory kept alive by the caller, e.g. a mapped base, and are then used in place
+        struct AllPairsData {
+            static constexpr uint32_t NO_PREV_EDGE = std::numeric_limits<uint32_t>::max();
+            ranges::StoredArray<Weight> weights;
+            ranges::StoredArray<uint32_t> prev_edges;
+        };
+
+        explicit Router(const Graph& graph, RouterMode mode = RouterMode::ALL_PAIRS);
+        // Uses a hierarchy prepared earlier, e.g. read from a serialized base
+        Router(const Graph& graph, ContractionHierarchy<Weight> hierarchy);
+        // Uses routes of ALL_PAIRS or BLOCKED_ALL_PAIRS prepared earlier, answering from the matrices in both modes;
+        // throws std::invalid_argument if their sizes don't fit the graph. The edges are checked only along routes
+        // asked for, so that a mapped base isn't read in full: a bad edge or a cycle then throws std::runtime_error
+        Router(const Graph& graph, RouterMode mode, AllPairsData data);
 
         struct RouteInfo {
             Weight weight;
@@ -29,27 +62,48 @@ namespace graph {
 
         std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
 
+        RouterMode GetMode() const {
+            return mode_;
+        }
+        // nullptr unless the mode is CONTRACTION_HIERARCHY
+        const ContractionHierarchy<Weight>* GetContractionHierarchy() const {
+            return hierarchy_ ? &*hierarchy_ : nullptr;
+        }
+        // Calls callback(from, weights, prev_edges) with pointers to the vertex_count entries of each row of
+        // the ALL_PAIRS modes' routes in the form of AllPairsData, without building whole matrices; false for the other modes
+        template <typename Callback>
+        bool ForEachAllPairsRow(Callback&& callback) const;
+
     private:
         struct RouteInternalData {
             Weight weight;
             std::optional<EdgeId> prev_edge;
         };
-        using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
+        // Routes from one source vertex, indexed by the target vertex
+        using RoutesFromVertex = std::vector<std::optional<RouteInternalData>>;
+        using RoutesInternalData = std::vector<RoutesFromVertex>;
+
+        void CheckWeights(const Graph& graph) const {
+            for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+                if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+                    throw std::domain_error("Edges' weights should be non-negative");
+                }
+            }
+        }
 
         void InitializeRoutesInternalData(const Graph& graph) {
             const size_t vertex_count = graph.GetVertexCount();
             for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
                 routes_internal_data_[vertex][vertex] = RouteInternalData{ ZERO_WEIGHT, std::nullopt };
-                for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
-                    const auto& edge = graph.GetEdge(edge_id);
+                graph.ForEachOutgoingEdge(vertex, [this, vertex](const OutgoingEdge<Weight>& edge) {
                     if (edge.weight < ZERO_WEIGHT) {
                         throw std::domain_error("Edges' weights should be non-negative");
                     }
                     auto& route_internal_data = routes_internal_data_[vertex][edge.to];
                     if (!route_internal_data || route_internal_data->weight > edge.weight) {
-                        route_internal_data = RouteInternalData{ edge.weight, edge_id };
+                        route_internal_data = RouteInternalData{ edge.weight, edge.id };
                     }
-                }
+                });
             }
         }
 
@@ -75,17 +129,246 @@ namespace graph {
             }
         }
 
+        // Shortest-path tree from `from`; with a target the search stops as soon as the target is settled
+        RoutesFromVertex ComputeRoutesFrom(VertexId from, std::optional<VertexId> target) const {
+            using QueueItem = std::pair<Weight, VertexId>;
+            RoutesFromVertex routes(graph_.GetVertexCount());
+            std::vector<bool> settled(graph_.GetVertexCount(), false);
+            std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+
+            routes[from] = RouteInternalData{ ZERO_WEIGHT, std::nullopt };
+            queue.push({ ZERO_WEIGHT, from });
+            while (!queue.empty()) {
+                const auto [weight, vertex] = queue.top();
+                queue.pop();
+                if (settled[vertex]) {
+                    continue;
+                }
+                settled[vertex] = true;
+                if (target && vertex == *target) {
+                    break;
+                }
+                graph_.ForEachOutgoingEdge(vertex, [&, weight = weight](const OutgoingEdge<Weight>& edge) {
+                    const Weight candidate_weight = weight + edge.weight;
+                    auto& route = routes[edge.to];
+                    if (!route || candidate_weight < route->weight) {
+                        route = RouteInternalData{ candidate_weight, edge.id };
+                        queue.push({ candidate_weight, edge.to });
+                    }
+                });
+            }
+            return routes;
+        }
+
+        std::shared_ptr<const RoutesFromVertex> GetCachedRoutesFrom(VertexId from) const {
+            {
+                std::lock_guard guard(cache_mutex_);
+                if (const auto it = routes_cache_.find(from); it != routes_cache_.end()) {
+                    routes_cache_order_.splice(routes_cache_order_.begin(), routes_cache_order_, it->second);
+                    return it->second->second;
+                }
+            }
+            // The tree is computed outside the lock; a concurrent duplicate computation is harmless
+            auto routes = std::make_shared<const RoutesFromVertex>(ComputeRoutesFrom(from, std::nullopt));
+            std::lock_guard guard(cache_mutex_);
+            if (const auto it = routes_cache_.find(from); it != routes_cache_.end()) {
+                routes_cache_order_.splice(routes_cache_order_.begin(), routes_cache_order_, it->second);
+                return it->second->second;
+            }
+            routes_cache_order_.emplace_front(from, routes);
+            routes_cache_.emplace(from, routes_cache_order_.begin());
+            // Trees still held by callers stay alive through their shared_ptr
+            if (routes_cache_order_.size() > ROUTES_CACHE_CAPACITY) {
+                routes_cache_.erase(routes_cache_order_.back().first);
+                routes_cache_order_.pop_back();
+            }
+            return routes;
+        }
+
+        std::optional<RouteInfo> BuildRouteFrom(const RoutesFromVertex& routes, VertexId to) const {
+            const auto& route_internal_data = routes.at(to);
+            if (!route_internal_data) {
+                return std::nullopt;
+            }
+            const Weight weight = route_internal_data->weight;
+            std::vector<EdgeId> edges;
+            for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
+                edge_id;
+                edge_id = routes[graph_.GetEdge(*edge_id).from]->prev_edge)
+            {
+                edges.push_back(*edge_id);
+            }
+            std::reverse(edges.begin(), edges.end());
+
+            return RouteInfo{ weight, std::move(edges) };
+        }
+
+        void InitializeMatrices(const Graph& graph) {
+            const size_t vertex_count = graph.GetVertexCount();
+            if (graph.GetEdgeCount() >= NO_PREV_EDGE) {
+                throw std::length_error("Too many edges for the all-pairs matrices");
+            }
+            std::vector<Weight>& weights = weights_.GetMutable();
+            std::vector<uint32_t>& prev_edges = prev_edges_.GetMutable();
+            weights.assign(vertex_count * vertex_count, INFINITE_WEIGHT);
+            prev_edges.assign(vertex_count * vertex_count, NO_PREV_EDGE);
+            for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+                weights[vertex * vertex_count + vertex] = ZERO_WEIGHT;
+                graph.ForEachOutgoingEdge(vertex, [&weights, &prev_edges, vertex, vertex_count](const OutgoingEdge<Weight>& edge) {
+                    if (edge.weight < ZERO_WEIGHT) {
+                        throw std::domain_error("Edges' weights should be non-negative");
+                    }
+                    const size_t index = vertex * vertex_count + edge.to;
+                    if (edge.weight < weights[index]) {
+                        weights[index] = edge.weight;
+                        prev_edges[index] = static_cast<uint32_t>(edge.id);
+                    }
+                });
+            }
+        }
+
+        // Relaxes routes i -> j of the tile through every k of the k-tile.
+        // A route through k never ends with the empty route k -> k, so the new last edge is always prev(k, j)
+        void RelaxTile(size_t k_tile, size_t i_tile, size_t j_tile) {
+            const size_t vertex_count = graph_.GetVertexCount();
+            // The matrices are owned while they are computed, so this doesn't change them
+            Weight* const weights = weights_.GetMutable().data();
+            uint32_t* const prev_edges = prev_edges_.GetMutable().data();
+            const size_t k_last = std::min(vertex_count, (k_tile + 1) * TILE_SIZE);
+            const size_t i_last = std::min(vertex_count, (i_tile + 1) * TILE_SIZE);
+            const size_t j_first = j_tile * TILE_SIZE;
+            const size_t j_last = std::min(vertex_count, j_first + TILE_SIZE);
+            for (size_t k = k_tile * TILE_SIZE; k < k_last; ++k) {
+                const Weight* weights_k = weights + k * vertex_count;
+                const uint32_t* prev_k = prev_edges + k * vertex_count;
+                for (size_t i = i_tile * TILE_SIZE; i < i_last; ++i) {
+                    const Weight through = weights[i * vertex_count + k];
+                    if (through == INFINITE_WEIGHT) {
+                        continue;
+                    }
+                    Weight* weights_i = weights + i * vertex_count;
+                    uint32_t* prev_i = prev_edges + i * vertex_count;
+                    // Branch-free body, so the compiler can vectorize it
+                    for (size_t j = j_first; j < j_last; ++j) {
+                        const Weight candidate = through + weights_k[j];
+                        const bool is_better = candidate < weights_i[j];
+                        weights_i[j] = is_better ? candidate : weights_i[j];
+                        prev_i[j] = is_better ? prev_k[j] : prev_i[j];
+                    }
+                }
+            }
+        }
+
+        // Each phase first closes the diagonal tile, then its row and column, then all the other tiles;
+        // tiles within the last two steps are independent and are relaxed in parallel
+        void RunBlockedFloydWarshall() {
+            const size_t tile_count = (graph_.GetVertexCount() + TILE_SIZE - 1) / TILE_SIZE;
+            for (size_t k_tile = 0; k_tile < tile_count; ++k_tile) {
+                RelaxTile(k_tile, k_tile, k_tile);
+                if (tile_count == 1) {
+                    break;
+                }
+                const size_t other_count = tile_count - 1;
+                parallel::ParallelFor(2 * other_count, [this, k_tile, other_count](size_t index) {
+                    const size_t tile = index % other_count;
+                    const size_t other = tile < k_tile ? tile : tile + 1;
+                    if (index < other_count) {
+                        RelaxTile(k_tile, k_tile, other);
+                    }
+                    else {
+                        RelaxTile(k_tile, other, k_tile);
+                    }
+                });
+                parallel::ParallelFor(other_count * other_count, [this, k_tile, other_count](size_t index) {
+                    const size_t i_tile = index / other_count;
+                    const size_t j_tile = index % other_count;
+                    RelaxTile(k_tile, i_tile < k_tile ? i_tile : i_tile + 1, j_tile < k_tile ? j_tile : j_tile + 1);
+                });
+            }
+        }
+
+        std::optional<RouteInfo> BuildRouteFromMatrices(VertexId from, VertexId to) const {
+            const size_t vertex_count = graph_.GetVertexCount();
+            if (from >= vertex_count || to >= vertex_count) {
+                throw std::out_of_range("Vertex is out of range");
+            }
+            const Weight weight = weights_[from * vertex_count + to];
+            if (weight == INFINITE_WEIGHT) {
+                return std::nullopt;
+            }
+            std::vector<EdgeId> edges;
+            for (uint32_t edge_id = prev_edges_[from * vertex_count + to];
+                edge_id != NO_PREV_EDGE;
+                edge_id = prev_edges_[from * vertex_count + graph_.GetEdge(edge_id).from])
+            {
+                if (edge_id >= graph_.GetEdgeCount()) {
+                    throw std::runtime_error("All-pairs routes don't match the graph");
+                }
+                // A shortest route visits each vertex once, so a longer chain can only come from stored matrices
+                // that loop, which would otherwise be walked forever
+                if (edges.size() == vertex_count) {
+                    throw std::runtime_error("All-pairs routes contain a cycle");
+                }
+                edges.push_back(edge_id);
+            }
+            std::reverse(edges.begin(), edges.end());
+
+            return RouteInfo{ weight, std::move(edges) };
+        }
+
         static constexpr Weight ZERO_WEIGHT{};
+        static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::infinity();
+        static constexpr uint32_t NO_PREV_EDGE = AllPairsData::NO_PREV_EDGE;
+        // 64 x 64 doubles of a tile row block fit into L1 together with the k rows
+        static constexpr size_t TILE_SIZE = 64;
+
         const Graph& graph_;
+        RouterMode mode_;
         RoutesInternalData routes_internal_data_;
+        std::optional<ContractionHierarchy<Weight>> hierarchy_;
+        // BLOCKED_ALL_PAIRS, or ALL_PAIRS built from AllPairsData: row-major vertex_count x vertex_count
+        // matrices of route weights and last edges
+        ranges::StoredArray<Weight> weights_;
+        ranges::StoredArray<uint32_t> prev_edges_;
+
+        bool HasMatrices() const {
+            return mode_ == RouterMode::BLOCKED_ALL_PAIRS || (mode_ == RouterMode::ALL_PAIRS && routes_internal_data_.empty());
+        }
+
+        // CACHED_DIJKSTRA keeps at most this many trees of V entries each, evicting the least recently used
+        static constexpr size_t ROUTES_CACHE_CAPACITY = 256;
+
+        using RoutesCacheList = std::list<std::pair<VertexId, std::shared_ptr<const RoutesFromVertex>>>;
+
+        mutable std::mutex cache_mutex_;
+        // Most recently used first
+        mutable RoutesCacheList routes_cache_order_;
+        mutable std::unordered_map<VertexId, typename RoutesCacheList::iterator> routes_cache_;
     };
 
     template <typename Weight>
-    Router<Weight>::Router(const Graph& graph)
+    Router<Weight>::Router(const Graph& graph, RouterMode mode)
         : graph_(graph)
-        , routes_internal_data_(graph.GetVertexCount(),
-            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
+        , mode_(mode)
     {
+        if (mode_ == RouterMode::CONTRACTION_HIERARCHY) {
+            hierarchy_.emplace(graph);
+            return;
+        }
+        if (mode_ == RouterMode::BLOCKED_ALL_PAIRS) {
+            if constexpr (!std::is_floating_point_v<Weight>) {
+                throw std::invalid_argument("BLOCKED_ALL_PAIRS needs floating-point weights");
+            }
+            InitializeMatrices(graph);
+            RunBlockedFloydWarshall();
+            return;
+        }
+        if (mode_ != RouterMode::ALL_PAIRS) {
+            CheckWeights(graph);
+            return;
+        }
+
+        routes_internal_data_.assign(graph.GetVertexCount(), RoutesFromVertex(graph.GetVertexCount()));
         InitializeRoutesInternalData(graph);
 
         const size_t vertex_count = graph.GetVertexCount();
@@ -94,24 +377,86 @@ namespace graph {
         }
     }
 
+    template <typename Weight>
+    Router<Weight>::Router(const Graph& graph, ContractionHierarchy<Weight> hierarchy)
+        : graph_(graph)
+        , mode_(RouterMode::CONTRACTION_HIERARCHY)
+        , hierarchy_(std::move(hierarchy))
+    {
+    }
+
+    template <typename Weight>
+    Router<Weight>::Router(const Graph& graph, RouterMode mode, AllPairsData data)
+        : graph_(graph)
+        , mode_(mode)
+    {
+        if constexpr (!std::is_floating_point_v<Weight>) {
+            throw std::invalid_argument("Stored all-pairs routes need floating-point weights");
+        }
+        const size_t vertex_count = graph.GetVertexCount();
+        if ((mode_ != RouterMode::ALL_PAIRS && mode_ != RouterMode::BLOCKED_ALL_PAIRS)
+            || data.weights.size() != vertex_count * vertex_count
+            || data.prev_edges.size() != vertex_count * vertex_count) {
+            throw std::invalid_argument("All-pairs routes don't match the graph");
+        }
+        weights_ = std::move(data.weights);
+        prev_edges_ = std::move(data.prev_edges);
+    }
+
+    template <typename Weight>
+    template <typename Callback>
+    bool Router<Weight>::ForEachAllPairsRow(Callback&& callback) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (HasMatrices()) {
+            for (VertexId from = 0; from < vertex_count; ++from) {
+                callback(from, weights_.data() + from * vertex_count, prev_edges_.data() + from * vertex_count);
+            }
+            return true;
+        }
+        if (mode_ != RouterMode::ALL_PAIRS || !std::is_floating_point_v<Weight>) {
+            return false;
+        }
+        std::vector<Weight> weights(vertex_count);
+        std::vector<uint32_t> prev_edges(vertex_count);
+        for (VertexId from = 0; from < vertex_count; ++from) {
+            for (VertexId to = 0; to < vertex_count; ++to) {
+                const auto& route = routes_internal_data_[from][to];
+                weights[to] = route ? route->weight : INFINITE_WEIGHT;
+                prev_edges[to] = route && route->prev_edge ? static_cast<uint32_t>(*route->prev_edge) : NO_PREV_EDGE;
+            }
+            callback(from, weights.data(), prev_edges.data());
+        }
+        return true;
+    }
+
     template <typename Weight>
     std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
         VertexId to) const {
-        const auto& route_internal_data = routes_internal_data_.at(from).at(to);
-        if (!route_internal_data) {
+        switch (mode_) {
+        case RouterMode::ALL_PAIRS:
+            if (HasMatrices()) {
+                return BuildRouteFromMatrices(from, to);
+            }
+            return BuildRouteFrom(routes_internal_data_.at(from), to);
+        case RouterMode::DIJKSTRA:
+            if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+                throw std::out_of_range("Vertex is out of range");
+            }
+            return BuildRouteFrom(ComputeRoutesFrom(from, to), to);
+        case RouterMode::CACHED_DIJKSTRA:
+            if (from >= graph_.GetVertexCount()) {
+                throw std::out_of_range("Vertex is out of range");
+            }
+            return BuildRouteFrom(*GetCachedRoutesFrom(from), to);
+        case RouterMode::BLOCKED_ALL_PAIRS:
+            return BuildRouteFromMatrices(from, to);
+        case RouterMode::CONTRACTION_HIERARCHY:
+            if (auto route = hierarchy_->FindRoute(from, to)) {
+                return RouteInfo{ route->weight, std::move(route->edges) };
+            }
             return std::nullopt;
         }
-        const Weight weight = route_internal_data->weight;
-        std::vector<EdgeId> edges;
-        for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
-            edge_id;
-            edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
-        {
-            edges.push_back(*edge_id);
-        }
-        std::reverse(edges.begin(), edges.end());
-
-        return RouteInfo{ weight, std::move(edges) };
+        return std::nullopt;
     }
 
 }  // namespace graph
\ No newline at end of file
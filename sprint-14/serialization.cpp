@@ -1,11 +1,125 @@
 #include "serialization.h"
+#include "transport_router.h"
+#include "flat_base.h"
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <google/protobuf/wire_format.h>
+#include <google/protobuf/wire_format_lite.h>
+
+#include "parallel.h"
+
+#include <algorithm>
+#include <array>
 #include <fstream>
+#include <limits>
+#include <utility>
 
 namespace serialization {
 
-	using cont_distances = std::unordered_map<std::pair<const TransportCatalogue::Stop*, const TransportCatalogue::Stop*>, int, TransportCatalogue::detail::HasherPairStops>;
 	using ColorSvg = std::variant<std::monostate, std::string, svg::Rgb, svg::Rgba>;
 
+	namespace {
+
+		// A length-delimited field of the TransportCatalogue message, written without building the whole message
+		void WriteRecord(google::protobuf::io::CodedOutputStream& output, int field, const google::protobuf::MessageLite& record) {
+			using google::protobuf::internal::WireFormatLite;
+			output.WriteTag(WireFormatLite::MakeTag(field, WireFormatLite::WIRETYPE_LENGTH_DELIMITED));
+			output.WriteVarint32(static_cast<uint32_t>(record.ByteSizeLong()));
+			record.SerializeWithCachedSizes(&output);
+		}
+
+		bool ReadRecord(google::protobuf::io::CodedInputStream& input, google::protobuf::MessageLite& record) {
+			uint32_t length = 0;
+			if (!input.ReadVarint32(&length)) {
+				return false;
+			}
+			const auto limit = input.PushLimit(static_cast<int>(length));
+			const bool parsed = record.ParseFromCodedStream(&input) && input.ConsumedEntireMessage();
+			input.PopLimit(limit);
+			return parsed;
+		}
+
+		// Ranks and shortcuts per record of a stored hierarchy
+		constexpr size_t HIERARCHY_CHUNK_SIZE = 4096;
+
+		void WriteContractionHierarchy(google::protobuf::io::CodedOutputStream& output, const graph::ContractionHierarchy<double>& hierarchy) {
+			const auto& ranks = hierarchy.GetRanks();
+			const auto& shortcuts = hierarchy.GetShortcuts();
+			transport_catalogue_proto::ContractionHierarchy chunk_proto;
+			for (size_t begin = 0; begin < std::max(ranks.size(), shortcuts.size()); begin += HIERARCHY_CHUNK_SIZE) {
+				chunk_proto.Clear();
+				for (size_t i = begin; i < std::min(ranks.size(), begin + HIERARCHY_CHUNK_SIZE); ++i) {
+					chunk_proto.add_ranks(ranks[i]);
+				}
+				for (size_t i = begin; i < std::min(shortcuts.size(), begin + HIERARCHY_CHUNK_SIZE); ++i) {
+					transport_catalogue_proto::ContractionShortcut* shortcut_proto = chunk_proto.add_shortcuts();
+					shortcut_proto->set_from(static_cast<uint32_t>(shortcuts[i].from));
+					shortcut_proto->set_to(static_cast<uint32_t>(shortcuts[i].to));
+					shortcut_proto->set_weight(shortcuts[i].weight);
+					shortcut_proto->set_first(static_cast<uint32_t>(shortcuts[i].first));
+					shortcut_proto->set_second(static_cast<uint32_t>(shortcuts[i].second));
+				}
+				WriteRecord(output, transport_catalogue_proto::TransportCatalogue::kContractionHierarchyChunksFieldNumber, chunk_proto);
+			}
+		}
+
+		void AppendContractionHierarchy(const transport_catalogue_proto::ContractionHierarchy& hierarchy_proto, graph::ContractionHierarchy<double>::Data& data) {
+			std::vector<uint32_t>& ranks = data.ranks.GetMutable();
+			ranks.insert(ranks.end(), hierarchy_proto.ranks().begin(), hierarchy_proto.ranks().end());
+			std::vector<graph::ContractionHierarchy<double>::Shortcut>& shortcuts = data.shortcuts.GetMutable();
+			for (const auto& shortcut : hierarchy_proto.shortcuts()) {
+				shortcuts.push_back({ shortcut.from(), shortcut.to(), shortcut.weight(), shortcut.first(), shortcut.second() });
+			}
+		}
+
+		// Records of one field read as raw bytes and parsed in parallel a batch at a time: decoding is the costly part
+		// of a large table, reading its bytes isn't. The batch bounds the memory held besides the table itself
+		template <typename Record>
+		class RecordBatch {
+		public:
+			// Reads the length-delimited record at the input's position; false if the input ends inside it
+			bool Read(google::protobuf::io::CodedInputStream& input) {
+				uint32_t length = 0;
+				if (!input.ReadVarint32(&length) || !input.ReadString(&raw_records_[count_], static_cast<int>(length))) {
+					return false;
+				}
+				++count_;
+				return true;
+			}
+
+			bool IsFull() const {
+				return count_ == SIZE;
+			}
+
+			// Passes the records read since the last call to append(const Record&) in order; false if one is damaged,
+			// and then only the records before it are passed
+			template <typename Append>
+			bool Flush(Append append) {
+				parallel::ParallelFor(count_, [this](size_t i) {
+					parsed_[i] = records_[i].ParseFromString(raw_records_[i]);
+				});
+				const size_t count = std::exchange(count_, 0);
+				for (size_t i = 0; i < count; ++i) {
+					if (!parsed_[i]) {
+						return false;
+					}
+					append(records_[i]);
+				}
+				return true;
+			}
+
+		private:
+			static constexpr size_t SIZE = 16;
+
+			std::array<std::string, SIZE> raw_records_;
+			std::array<Record, SIZE> records_;
+			std::array<bool, SIZE> parsed_ = {};
+			size_t count_ = 0;
+		};
+
+	} //namespace
+
 	void Serializator::SetSerializationSettings(SerializationSettings&& set) {
 		catalog_set = set;
 	}
@@ -102,6 +216,8 @@ namespace serialization {
 		transport_catalogue_proto::BusTimesSettings sett_proto;
 		sett_proto.set_bus_wait_time(sett.bus_wait_time_);
 		sett_proto.set_bus_velocity_m_m(sett.bus_velocity_m_m_);
+		sett_proto.set_graph_model(sett.graph_model_ == TransportCatalogue::GraphModel::TRANSFER_NODES
+			? transport_catalogue_proto::TRANSFER_NODES : transport_catalogue_proto::STOP_PAIRS);
 		return sett_proto;
 	}
 
@@ -135,89 +251,350 @@ namespace serialization {
 		TransportCatalogue::BusTimesSettings sett;
 		sett.bus_wait_time_ = sett_proto.bus_wait_time();
 		sett.bus_velocity_m_m_ = sett_proto.bus_velocity_m_m();
+		sett.graph_model_ = sett_proto.graph_model() == transport_catalogue_proto::TRANSFER_NODES
+			? TransportCatalogue::GraphModel::TRANSFER_NODES : TransportCatalogue::GraphModel::STOP_PAIRS;
 		return sett;
 	}
 
-	void Serializator::CatalogueSerialize(const TransportCatalogue::TransportCatalogue& catalog,
-		                                  TransportCatalogue::BusTimesSettings time_settings,
-		                                  RenderSettings settings) const {
-		std::ofstream fout(catalog_set.file_name, std::ios::binary);
-		transport_catalogue_proto::TransportCatalogue cat_proto;
+	transport_catalogue_proto::RouterMode Serializator::GetRouterModeProto(graph::RouterMode mode) const {
+		switch (mode) {
+		case graph::RouterMode::ALL_PAIRS:
+			return transport_catalogue_proto::ALL_PAIRS;
+		case graph::RouterMode::DIJKSTRA:
+			return transport_catalogue_proto::DIJKSTRA;
+		case graph::RouterMode::CACHED_DIJKSTRA:
+			return transport_catalogue_proto::CACHED_DIJKSTRA;
+		case graph::RouterMode::CONTRACTION_HIERARCHY:
+			return transport_catalogue_proto::CONTRACTION_HIERARCHY;
+		case graph::RouterMode::BLOCKED_ALL_PAIRS:
+			return transport_catalogue_proto::BLOCKED_ALL_PAIRS;
+		}
+		return transport_catalogue_proto::CACHED_DIJKSTRA;
+	}
+
+	graph::RouterMode Serializator::GetRouterMode(transport_catalogue_proto::RouterMode mode_proto) const {
+		switch (mode_proto) {
+		case transport_catalogue_proto::ALL_PAIRS:
+			return graph::RouterMode::ALL_PAIRS;
+		case transport_catalogue_proto::DIJKSTRA:
+			return graph::RouterMode::DIJKSTRA;
+		case transport_catalogue_proto::CONTRACTION_HIERARCHY:
+			return graph::RouterMode::CONTRACTION_HIERARCHY;
+		case transport_catalogue_proto::BLOCKED_ALL_PAIRS:
+			return graph::RouterMode::BLOCKED_ALL_PAIRS;
+		default:
+			return graph::RouterMode::CACHED_DIJKSTRA;
+		}
+	}
+
+	transport_catalogue_proto::TransportRouter Serializator::GetTransportRouterProto(const TransportCatalogue::TransportCatalogue& catalog,
+		                                                                              const TransportCatalogue::transport_router::TransportRouter& router) const {
+		using TransportCatalogue::transport_router::EdgeKind;
+		transport_catalogue_proto::TransportRouter router_proto;
+		const graph::DirectedWeightedGraph<double>& graph = router.GetGraph();
+		transport_catalogue_proto::Graph* graph_proto = router_proto.mutable_graph();
+		graph_proto->set_vertex_count(static_cast<uint32_t>(graph.GetVertexCount()));
+		graph_proto->mutable_edges()->Reserve(static_cast<int>(graph.GetEdgeCount()));
+		router_proto.mutable_edges()->Reserve(static_cast<int>(graph.GetEdgeCount()));
+		for (const TransportCatalogue::transport_router::TGraphEdge& edge : router.GetEdges()) {
+			const graph::Edge<double>& graph_edge = graph.GetEdge(edge.id);
+			transport_catalogue_proto::Edge* edge_proto = graph_proto->add_edges();
+			edge_proto->set_from(static_cast<uint32_t>(graph_edge.from));
+			edge_proto->set_to(static_cast<uint32_t>(graph_edge.to));
+			edge_proto->set_weight(graph_edge.weight);
+
+			transport_catalogue_proto::RouteEdge* route_edge_proto = router_proto.add_edges();
+			route_edge_proto->set_stop(catalog.FindStop(edge.from)->id);
+			route_edge_proto->set_bus(catalog.FindBus(edge.name)->id);
+			route_edge_proto->set_span_count(static_cast<uint32_t>(edge.span_count_));
+			switch (edge.kind) {
+			case EdgeKind::SPAN:
+				route_edge_proto->set_kind(transport_catalogue_proto::SPAN);
+				break;
+			case EdgeKind::BOARD:
+				route_edge_proto->set_kind(transport_catalogue_proto::BOARD);
+				break;
+			case EdgeKind::RIDE:
+				route_edge_proto->set_kind(transport_catalogue_proto::RIDE);
+				break;
+			case EdgeKind::ALIGHT:
+				route_edge_proto->set_kind(transport_catalogue_proto::ALIGHT);
+				break;
+			}
+		}
+		for (const auto& [stop, vertex] : router.GetStopVertexes()) {
+			transport_catalogue_proto::StopVertex* stop_vertex_proto = router_proto.add_stop_vertexes();
+			stop_vertex_proto->set_stop(catalog.FindStop(stop)->id);
+			stop_vertex_proto->set_vertex(static_cast<uint32_t>(vertex));
+		}
+		return router_proto;
+	}
+
+	void Serializator::RestoreGraph(const TransportCatalogue::TransportCatalogue& catalog,
+		                            TransportCatalogue::transport_router::TransportRouter& router,
+		                            const transport_catalogue_proto::TransportRouter& router_proto) const {
+		using namespace TransportCatalogue::transport_router;
+		const transport_catalogue_proto::Graph& graph_proto = router_proto.graph();
+		if (graph_proto.edges_size() != router_proto.edges_size()) {
+			return;
+		}
 		const std::deque<TransportCatalogue::Stop>& stops = catalog.GetStopsConst();
 		const std::deque<TransportCatalogue::Bus>& buses = catalog.GetBusesConst();
-		const cont_distances& dists = catalog.GetDistancesConst();
 
-		std::map<std::string_view, uint32_t> indexes_st;
-		uint32_t id = 0;
-		size_t size = stops.size();
-		for (const TransportCatalogue::Stop& st : stops) {
-			transport_catalogue_proto::Stop* st_proto = cat_proto.add_stops();
-			transport_catalogue_proto::Coordinates coord;
-			coord.set_lat(st.coordinates.lat);
-			coord.set_lng(st.coordinates.lng);
-			st_proto->set_name(st.name_stop);
-			*(st_proto->mutable_coordinates()) = coord;
-			indexes_st[st.name_stop] = id++;
+		std::vector<graph::Edge<double>> graph_edges;
+		graph_edges.reserve(graph_proto.edges_size());
+		std::vector<TGraphEdge> edges;
+		edges.reserve(router_proto.edges_size());
+		for (int i = 0; i < graph_proto.edges_size(); ++i) {
+			const transport_catalogue_proto::Edge& edge_proto = graph_proto.edges(i);
+			const transport_catalogue_proto::RouteEdge& route_edge_proto = router_proto.edges(i);
+			if (route_edge_proto.stop() >= stops.size() || route_edge_proto.bus() >= buses.size()) {
+				return;
+			}
+			graph_edges.push_back({ edge_proto.from(), edge_proto.to(), edge_proto.weight() });
+			EdgeKind kind = EdgeKind::SPAN;
+			switch (route_edge_proto.kind()) {
+			case transport_catalogue_proto::BOARD:
+				kind = EdgeKind::BOARD;
+				break;
+			case transport_catalogue_proto::RIDE:
+				kind = EdgeKind::RIDE;
+				break;
+			case transport_catalogue_proto::ALIGHT:
+				kind = EdgeKind::ALIGHT;
+				break;
+			default:
+				break;
+			}
+			edges.push_back({ static_cast<graph::EdgeId>(i), stops[route_edge_proto.stop()].name_stop, buses[route_edge_proto.bus()].name_bus,
+				              route_edge_proto.span_count(), edge_proto.weight(), kind });
 		}
 
-		for (const TransportCatalogue::Bus& bs : buses) {
-			transport_catalogue_proto::Bus* bs_proto = cat_proto.add_buses();
-			for (const auto& st : bs.stops_for_bus_) {
-				bs_proto->add_ind_stops(indexes_st[st]);
+		TransportRouter::StopVertexes vertexes;
+		vertexes.reserve(router_proto.stop_vertexes_size());
+		for (const auto& stop_vertex_proto : router_proto.stop_vertexes()) {
+			if (stop_vertex_proto.stop() >= stops.size() || stop_vertex_proto.vertex() >= graph_proto.vertex_count()) {
+				return;
 			}
-			bs_proto->set_looping(bs.looping);
-			bs_proto->set_name(bs.name_bus);
+			vertexes[stops[stop_vertex_proto.stop()].name_stop] = stop_vertex_proto.vertex();
 		}
 
-		for (const auto& para : dists) {
-			transport_catalogue_proto::Distance* ds_proto = cat_proto.add_distances();
-			ds_proto->set_from(indexes_st[para.first.first->name_stop]);
-			ds_proto->set_to(indexes_st[para.first.second->name_stop]);
-			ds_proto->set_distance(para.second);
+		try {
+			router.RestoreGraph(graph::DirectedWeightedGraph<double>(graph_proto.vertex_count(), std::move(graph_edges)),
+				                std::move(edges), std::move(vertexes));
+		}
+		catch (const std::out_of_range&) {
+			// A damaged graph is left out: the router builds its own one
 		}
-
-		*cat_proto.mutable_render_settings() = GetProtoRenderSettings(settings);
-		*cat_proto.mutable_time_settings() = GetBusTimesSettingsProto(time_settings);
-        
-        /*std::vector<std::string> lol_v(48900, "dfhgdfghlf uhgkjdfhgkrhtweit huerhtwuithwuthtueq heuwthewuth ruhid rtrhugjdhgdjrhgrutrhtrutrhtuhe");
-		for (const auto& para : lol_v) {
-			cat_proto.add_lol(para);
-		}*/
-        
-		cat_proto.SerializeToOstream(&fout);
 	}
 
-	transport_catalogue_proto::TransportCatalogue Serializator::CatalogueDeserialize() const {
-		std::ifstream input(catalog_set.file_name, std::ios::binary);
-		transport_catalogue_proto::TransportCatalogue cat_proto;
-		cat_proto.ParseFromIstream(&input);
-    
-		return cat_proto;
+	void Serializator::FillRouter(const TransportCatalogue::TransportCatalogue& catalog,
+		                          TransportCatalogue::transport_router::TransportRouter& router,
+		                          const transport_catalogue_proto::TransportCatalogue& cat_proto,
+		                          RouterTables tables) const {
+		router.SetSettings(GetBusTimesSettings(cat_proto.time_settings()));
+		router.SetRouterMode(GetRouterMode(cat_proto.router_mode()));
+		if (!cat_proto.has_router()) {
+			return;
+		}
+		RestoreGraph(catalog, router, cat_proto.router());
+		if (!router.HasGraph()) {
+			// Router data is useless without the graph it was computed for
+			return;
+		}
+		if (tables.hierarchy) {
+			router.SetContractionHierarchyData(std::move(*tables.hierarchy));
+		}
+		if (tables.all_pairs) {
+			router.SetAllPairsData(std::move(*tables.all_pairs));
+		}
 	}
 
-	void Serializator::FillCatalogue(TransportCatalogue::TransportCatalogue& catalog, transport_catalogue_proto::TransportCatalogue cat_proto) const {
-		std::map<uint32_t, std::string> ids_stops;
-		uint32_t id = 0;
-		for (const auto& st : cat_proto.stops()) {
-			transport_catalogue_proto::Coordinates coord = st.coordinates();
-			geo::Coordinates coordinates(coord.lat(), coord.lng());
-			catalog.AddStop(st.name(), coordinates);
-			ids_stops[id++] = st.name();
+	void Serializator::CatalogueSerialize(const TransportCatalogue::TransportCatalogue& catalog,
+		                                  const TransportCatalogue::transport_router::TransportRouter& router,
+		                                  RenderSettings settings,
+		                                  const std::string& map) const {
+		if (catalog_set.format == BaseFormat::FLAT) {
+			transport_catalogue_proto::TransportCatalogue settings_proto;
+			*settings_proto.mutable_render_settings() = GetProtoRenderSettings(settings);
+			*settings_proto.mutable_time_settings() = GetBusTimesSettingsProto(router.GetSettings());
+			settings_proto.set_router_mode(GetRouterModeProto(router.GetRouterMode()));
+			settings_proto.set_map(map);
+			flat_base::WriteBase(catalog_set.file_name, catalog, router, settings_proto.SerializeAsString());
+			return;
+		}
+
+		std::ofstream fout(catalog_set.file_name, std::ios::binary);
+		google::protobuf::io::OstreamOutputStream raw_output(&fout);
+		google::protobuf::io::CodedOutputStream output(&raw_output);
+		using CatalogueProto = transport_catalogue_proto::TransportCatalogue;
+
+		transport_catalogue_proto::Stop st_proto;
+		for (const TransportCatalogue::Stop& st : catalog.GetStopsConst()) {
+			st_proto.set_name(std::string(st.name_stop));
+			st_proto.mutable_coordinates()->set_lat(st.coordinates.lat);
+			st_proto.mutable_coordinates()->set_lng(st.coordinates.lng);
+			WriteRecord(output, CatalogueProto::kStopsFieldNumber, st_proto);
+		}
+
+		transport_catalogue_proto::Bus bs_proto;
+		for (const TransportCatalogue::Bus& bs : catalog.GetBusesConst()) {
+			const TransportCatalogue::RouteRange route = catalog.GetRoute(bs.id);
+			bs_proto.mutable_ind_stops()->Clear();
+			bs_proto.mutable_ind_stops()->Add(route.begin(), route.end());
+			bs_proto.set_looping(bs.looping);
+			bs_proto.set_name(std::string(bs.name_bus));
+			const TransportCatalogue::detail::InformationBus info = catalog.GetInformationBus(bs.id);
+			bs_proto.mutable_statistics()->set_route_length(info.distance);
+			bs_proto.mutable_statistics()->set_curvature(info.curv);
+			WriteRecord(output, CatalogueProto::kBusesFieldNumber, bs_proto);
+		}
+
+		transport_catalogue_proto::Distance ds_proto;
+		const uint32_t size = static_cast<uint32_t>(catalog.GetStopsConst().size());
+		for (uint32_t from = 0; from < size; ++from) {
+			for (const TransportCatalogue::DistanceEntry& entry : catalog.GetDistancesFrom(from)) {
+				ds_proto.set_from(from);
+				ds_proto.set_to(entry.to);
+				ds_proto.set_distance(entry.distance);
+				WriteRecord(output, CatalogueProto::kDistancesFieldNumber, ds_proto);
+			}
+		}
+
+		// Settings and the graph go as one message: concatenated messages are merged on parsing.
+		// The graph precedes the router tables, so that loading knows their size in advance
+		CatalogueProto rest_proto;
+		*rest_proto.mutable_render_settings() = GetProtoRenderSettings(settings);
+		*rest_proto.mutable_time_settings() = GetBusTimesSettingsProto(router.GetSettings());
+		rest_proto.set_router_mode(GetRouterModeProto(router.GetRouterMode()));
+		rest_proto.set_map(map);
+		if (router.GetRouter() != nullptr) {
+			*rest_proto.mutable_router() = GetTransportRouterProto(catalog, router);
+		}
+		rest_proto.SerializeToCodedStream(&output);
+		if (router.GetRouter() == nullptr) {
+			return;
 		}
 
-		for (const auto& bs : cat_proto.buses()) {
-			std::vector<std::string> stops_for_bus;
-			stops_for_bus.reserve(bs.ind_stops_size());
-			for (uint32_t id_s : bs.ind_stops()) {
-				stops_for_bus.push_back(ids_stops[id_s]);
+		transport_catalogue_proto::AllPairsRoutes row_proto;
+		const size_t vertex_count = router.GetGraph().GetVertexCount();
+		router.GetRouter()->ForEachAllPairsRow([&](graph::VertexId, const double* weights, const uint32_t* prev_edges) {
+			row_proto.mutable_weights()->Clear();
+			row_proto.mutable_weights()->Add(weights, weights + vertex_count);
+			row_proto.mutable_prev_edges()->Clear();
+			row_proto.mutable_prev_edges()->Add(prev_edges, prev_edges + vertex_count);
+			WriteRecord(output, CatalogueProto::kAllPairsRowsFieldNumber, row_proto);
+		});
+		if (const graph::ContractionHierarchy<double>* hierarchy = router.GetRouter()->GetContractionHierarchy()) {
+			WriteContractionHierarchy(output, *hierarchy);
+		}
+	}
+
+	transport_catalogue_proto::TransportCatalogue Serializator::LoadCatalogue(TransportCatalogue::TransportCatalogue& catalog, RouterTables& tables) const {
+		using google::protobuf::internal::WireFormat;
+		using google::protobuf::internal::WireFormatLite;
+		using CatalogueProto = transport_catalogue_proto::TransportCatalogue;
+		std::ifstream input(catalog_set.file_name, std::ios::binary);
+		google::protobuf::io::IstreamInputStream raw_input(&input);
+		google::protobuf::io::CodedInputStream coded_input(&raw_input);
+		coded_input.SetTotalBytesLimit(std::numeric_limits<int>::max());
+
+		// Fields other than records are merged into the result as they come
+		CatalogueProto rest_proto;
+		const google::protobuf::Descriptor* descriptor = CatalogueProto::descriptor();
+
+		transport_catalogue_proto::Stop st_proto;
+		transport_catalogue_proto::Bus bs_proto;
+		transport_catalogue_proto::Distance ds_proto;
+		// Router tables are the bulk of a base, so their records are decoded in parallel
+		RecordBatch<transport_catalogue_proto::AllPairsRoutes> rows;
+		RecordBatch<transport_catalogue_proto::ContractionHierarchy> chunks;
+		const auto append_row = [&tables, &rest_proto](const transport_catalogue_proto::AllPairsRoutes& row_proto) {
+			if (!tables.all_pairs) {
+				tables.all_pairs.emplace();
+			}
+			std::vector<double>& weights = tables.all_pairs->weights.GetMutable();
+			std::vector<uint32_t>& prev_edges = tables.all_pairs->prev_edges.GetMutable();
+			// The graph is already read: when the rows match it, the matrices are allocated once
+			const size_t vertex_count = rest_proto.router().graph().vertex_count();
+			if (weights.empty() && static_cast<size_t>(row_proto.weights_size()) == vertex_count) {
+				weights.reserve(vertex_count * vertex_count);
+				prev_edges.reserve(vertex_count * vertex_count);
+			}
+			weights.insert(weights.end(), row_proto.weights().begin(), row_proto.weights().end());
+			prev_edges.insert(prev_edges.end(), row_proto.prev_edges().begin(), row_proto.prev_edges().end());
+		};
+		const auto append_chunk = [&tables](const transport_catalogue_proto::ContractionHierarchy& chunk_proto) {
+			if (!tables.hierarchy) {
+				tables.hierarchy.emplace();
+			}
+			AppendContractionHierarchy(chunk_proto, *tables.hierarchy);
+		};
+		bool has_statistics = true;
+		std::vector<TransportCatalogue::detail::InformationBus> statistics;
+		while (const uint32_t tag = coded_input.ReadTag()) {
+			const int field = WireFormatLite::GetTagFieldNumber(tag);
+			const bool is_record = WireFormatLite::GetTagWireType(tag) == WireFormatLite::WIRETYPE_LENGTH_DELIMITED;
+			if (is_record && field == CatalogueProto::kStopsFieldNumber) {
+				if (!ReadRecord(coded_input, st_proto)) {
+					break;
+				}
+				catalog.AddStop(st_proto.name(), geo::Coordinates(st_proto.coordinates().lat(), st_proto.coordinates().lng()));
+			}
+			else if (is_record && field == CatalogueProto::kBusesFieldNumber) {
+				if (!ReadRecord(coded_input, bs_proto)) {
+					break;
+				}
+				// Stops precede buses in every base, so route ids can be checked right away
+				catalog.AddBus(bs_proto.name(), bs_proto.looping(),
+					           std::vector<TransportCatalogue::StopId>(bs_proto.ind_stops().begin(), bs_proto.ind_stops().end()));
+				has_statistics = has_statistics && bs_proto.has_statistics();
+				statistics.emplace_back(catalog.GetBusesConst().back().static_infom,
+					                    bs_proto.statistics().route_length(), bs_proto.statistics().curvature());
+			}
+			else if (is_record && field == CatalogueProto::kDistancesFieldNumber) {
+				if (!ReadRecord(coded_input, ds_proto)) {
+					break;
+				}
+				catalog.SetDistance(ds_proto.from(), ds_proto.to(), ds_proto.distance());
+			}
+			else if (is_record && field == CatalogueProto::kAllPairsRowsFieldNumber) {
+				if (!rows.Read(coded_input) || (rows.IsFull() && !rows.Flush(append_row))) {
+					break;
+				}
+			}
+			else if (is_record && field == CatalogueProto::kContractionHierarchyChunksFieldNumber) {
+				if (!chunks.Read(coded_input) || (chunks.IsFull() && !chunks.Flush(append_chunk))) {
+					break;
+				}
+			}
+			else if (!WireFormat::ParseAndMergeField(tag, descriptor->FindFieldByNumber(field), &rest_proto, &coded_input)) {
+				break;
 			}
-			catalog.AddBus(bs.name(), bs.looping(), std::move(stops_for_bus));
 		}
 
-		for (const auto& dist : cat_proto.distances()) {
-			catalog.SetDistance(ids_stops[dist.from()], ids_stops[dist.to()], dist.distance());
+		// Records of a damaged base read before the damage are kept, as with the other fields
+		rows.Flush(append_row);
+		chunks.Flush(append_chunk);
+
+		if (has_statistics) {
+			catalog.RestoreBusStatistics(std::move(statistics));
 		}
+		catalog.Finalize();
 
+		return rest_proto;
+	}
+
+	std::optional<transport_catalogue_proto::TransportCatalogue> Serializator::LoadFlatBase(TransportCatalogue::TransportCatalogue& catalog,
+		                                                                                      TransportCatalogue::transport_router::TransportRouter& router,
+		                                                                                      std::unique_ptr<flat_base::MappedFile>& file) const {
+		if (!flat_base::IsFlatBase(catalog_set.file_name)) {
+			return std::nullopt;
+		}
+		file = std::make_unique<flat_base::MappedFile>(catalog_set.file_name);
+		transport_catalogue_proto::TransportCatalogue settings_proto;
+		settings_proto.ParseFromString(flat_base::ReadBase(*file, catalog, router));
+		return settings_proto;
 	}
 
 }
\ No newline at end of file
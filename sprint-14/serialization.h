@@ -3,11 +3,36 @@
 #include "transport_catalogue.h"
 #include "map_renderer.h"
 #include "domain.h"
+#include "router.h"
+
+#include <memory>
+#include <optional>
+
+// transport_router.h includes this header through json_reader.h
+namespace TransportCatalogue::transport_router {
+	class TransportRouter;
+}
 
 namespace serialization {
 
+	namespace flat_base {
+		class MappedFile;
+	}
+
+	enum class BaseFormat {
+		PROTOBUF,
+		FLAT, // see flat_base.h
+	};
+
 	struct SerializationSettings {
 		std::string file_name;
+		BaseFormat format = BaseFormat::PROTOBUF;
+	};
+
+	// Router tables of a protobuf base, decoded from their records straight into the form the router takes
+	struct RouterTables {
+		std::optional<graph::Router<double>::AllPairsData> all_pairs;
+		std::optional<graph::ContractionHierarchy<double>::Data> hierarchy;
 	};
 
 	class Serializator {
@@ -17,19 +42,40 @@ namespace serialization {
 
 		void SetSerializationSettings(SerializationSettings&& set);
 
+		// Stores the router with its graph when they are built, so that they are restored instead of rebuilt
 		void CatalogueSerialize(const TransportCatalogue::TransportCatalogue& catalog,
-			                    TransportCatalogue::BusTimesSettings time_settings,
-			                    RenderSettings settings) const;
-		transport_catalogue_proto::TransportCatalogue CatalogueDeserialize() const;
+			                    const TransportCatalogue::transport_router::TransportRouter& router,
+			                    RenderSettings settings,
+			                    const std::string& map) const;
+		// Streams the base into the catalogue and the router tables record by record and returns the other fields:
+		// settings and the router's graph
+		transport_catalogue_proto::TransportCatalogue LoadCatalogue(TransportCatalogue::TransportCatalogue& catalog, RouterTables& tables) const;
+		// For a flat base maps it into `file`, fills the catalogue and the router's graph and tables and returns the settings part,
+		// to be applied as for a protobuf base; nullopt if the base is not flat. The catalogue and the router use large arrays
+		// of the base in place, so `file` must outlive their use
+		std::optional<transport_catalogue_proto::TransportCatalogue> LoadFlatBase(TransportCatalogue::TransportCatalogue& catalog,
+			                                                                       TransportCatalogue::transport_router::TransportRouter& router,
+			                                                                       std::unique_ptr<flat_base::MappedFile>& file) const;
 
-		void FillCatalogue(TransportCatalogue::TransportCatalogue& catalog, transport_catalogue_proto::TransportCatalogue cat_proto) const;
+		// Settings, mode, graph and router data; call after LoadCatalogue, since the graph refers to catalogue names
+		void FillRouter(const TransportCatalogue::TransportCatalogue& catalog,
+			            TransportCatalogue::transport_router::TransportRouter& router,
+			            const transport_catalogue_proto::TransportCatalogue& cat_proto,
+			            RouterTables tables = {}) const;
 		RenderSettings GetRenderSettings(transport_catalogue_proto::RenderSettings set_proto) const;
 		TransportCatalogue::BusTimesSettings GetBusTimesSettings(transport_catalogue_proto::BusTimesSettings sett_proto) const;
+		graph::RouterMode GetRouterMode(transport_catalogue_proto::RouterMode mode_proto) const;
 
 	private:
 		SerializationSettings catalog_set;
 
 		transport_catalogue_proto::BusTimesSettings GetBusTimesSettingsProto(TransportCatalogue::BusTimesSettings sett) const;
+		transport_catalogue_proto::RouterMode GetRouterModeProto(graph::RouterMode mode) const;
+		transport_catalogue_proto::TransportRouter GetTransportRouterProto(const TransportCatalogue::TransportCatalogue& catalog,
+			                                                                const TransportCatalogue::transport_router::TransportRouter& router) const;
+		void RestoreGraph(const TransportCatalogue::TransportCatalogue& catalog,
+			              TransportCatalogue::transport_router::TransportRouter& router,
+			              const transport_catalogue_proto::TransportRouter& router_proto) const;
 		transport_catalogue_proto::RenderSettings GetProtoRenderSettings(RenderSettings settings) const;
 	};
 
@@ -0,0 +1,80 @@
+#include "spatial_grid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace rendering {
+
+    // Cells per side: about one item per cell, within reasonable memory
+    static constexpr size_t MAX_GRID_SIDE = 1024;
+
+    SpatialGrid::SpatialGrid(Rect bounds, std::vector<Rect> items)
+        : bounds_(bounds)
+        , boxes_(std::move(items)) {
+        const size_t side = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(boxes_.size()))));
+        columns_ = std::clamp<size_t>(side, 1, MAX_GRID_SIDE);
+        rows_ = columns_;
+        cell_width_ = (bounds_.max_x - bounds_.min_x) / static_cast<double>(columns_);
+        cell_height_ = (bounds_.max_y - bounds_.min_y) / static_cast<double>(rows_);
+
+        // Counting sort of (cell, item) pairs: sizes first, then the items themselves
+        cell_offsets_.assign(columns_ * rows_ + 1, 0);
+        for (const Rect& box : boxes_) {
+            for (size_t row = Row(box.min_y); row <= Row(box.max_y); ++row) {
+                for (size_t column = Column(box.min_x); column <= Column(box.max_x); ++column) {
+                    ++cell_offsets_[row * columns_ + column + 1];
+                }
+            }
+        }
+        for (size_t i = 1; i < cell_offsets_.size(); ++i) {
+            cell_offsets_[i] += cell_offsets_[i - 1];
+        }
+        cell_items_.resize(cell_offsets_.back());
+        std::vector<uint32_t> next(cell_offsets_.begin(), cell_offsets_.end() - 1);
+        for (uint32_t id = 0; id < boxes_.size(); ++id) {
+            const Rect& box = boxes_[id];
+            for (size_t row = Row(box.min_y); row <= Row(box.max_y); ++row) {
+                for (size_t column = Column(box.min_x); column <= Column(box.max_x); ++column) {
+                    cell_items_[next[row * columns_ + column]++] = id;
+                }
+            }
+        }
+    }
+
+    size_t SpatialGrid::Column(double x) const {
+        if (!(cell_width_ > 0.0) || x <= bounds_.min_x) {
+            return 0;
+        }
+        return std::min(static_cast<size_t>((x - bounds_.min_x) / cell_width_), columns_ - 1);
+    }
+
+    size_t SpatialGrid::Row(double y) const {
+        if (!(cell_height_ > 0.0) || y <= bounds_.min_y) {
+            return 0;
+        }
+        return std::min(static_cast<size_t>((y - bounds_.min_y) / cell_height_), rows_ - 1);
+    }
+
+    std::vector<uint32_t> SpatialGrid::Query(Rect area) const {
+        std::vector<uint32_t> result;
+        if (boxes_.empty()) {
+            return result;
+        }
+        for (size_t row = Row(area.min_y); row <= Row(area.max_y); ++row) {
+            const size_t first_cell = row * columns_;
+            for (size_t column = Column(area.min_x); column <= Column(area.max_x); ++column) {
+                for (uint32_t i = cell_offsets_[first_cell + column]; i < cell_offsets_[first_cell + column + 1]; ++i) {
+                    if (boxes_[cell_items_[i]].Intersects(area)) {
+                        result.push_back(cell_items_[i]);
+                    }
+                }
+            }
+        }
+        // An item covering several cells is found in each of them
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+        return result;
+    }
+
+}//namespace rendering
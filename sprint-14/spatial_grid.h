@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace rendering {
+
+    struct Rect {
+        double min_x = 0.0;
+        double min_y = 0.0;
+        double max_x = 0.0;
+        double max_y = 0.0;
+
+        bool Intersects(const Rect& other) const {
+            return min_x <= other.max_x && other.min_x <= max_x
+                && min_y <= other.max_y && other.min_y <= max_y;
+        }
+    };
+
+    /*
+     * Uniform grid over a rectangle: every item is listed in the cells its bounding box covers,
+     * so a query looks only at the items of the cells under the queried area.
+     * Items outside the bounds fall into the border cells
+     */
+    class SpatialGrid {
+    public:
+        SpatialGrid() = default;
+        // The id of an item is its index in items
+        SpatialGrid(Rect bounds, std::vector<Rect> items);
+
+        // Ids of the items whose boxes intersect area, in ascending order
+        std::vector<uint32_t> Query(Rect area) const;
+
+    private:
+        Rect bounds_;
+        size_t columns_ = 0;
+        size_t rows_ = 0;
+        double cell_width_ = 0.0;
+        double cell_height_ = 0.0;
+        std::vector<Rect> boxes_;
+        // Items of cell i are cell_items_[cell_offsets_[i] .. cell_offsets_[i + 1]), cells go row by row
+        std::vector<uint32_t> cell_offsets_;
+        std::vector<uint32_t> cell_items_;
+
+        size_t Column(double x) const;
+        size_t Row(double y) const;
+    };
+
+}//namespace rendering
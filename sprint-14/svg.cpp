@@ -1,5 +1,9 @@
 #include "svg.h"
+
+#include <charconv>
 #include <iomanip>
+#include <iterator>
+#include <sstream>
 
 namespace svg {
 
@@ -66,56 +70,277 @@ namespace svg {
         return (os << s);
     }
 
-    void Circle::RenderObject(const RenderContext& context) const {
-        auto& out = context.out;
-        out << "<circle cx=\\\""sv << double(center_.x) << "\\\" cy=\\\""sv << double(center_.y) << "\\\" "sv;
-        out << "r=\\\""sv << radius_ << "\\\" "sv;
-        RenderAttrs(context.out);
-        out << "/>\\n"sv;
+    namespace {
+
+        // The same escapes json::Print uses for strings; empty if the character goes as is
+        std::string_view JsonEscape(char c) {
+            switch (c) {
+            case '\\':
+                return "\\\\"sv;
+            case '"':
+                return "\\\""sv;
+            case '\n':
+                return "\\n"sv;
+            case '\t':
+                return "\\t"sv;
+            case '\r':
+                return "\\r"sv;
+            default:
+                return {};
+            }
+        }
+
+    } // namespace
+
+    Writer& Writer::Append(std::string_view text) {
+        if (escaping_ == Escaping::NONE) {
+            out_.append(text);
+            return *this;
+        }
+        // Copies runs of plain characters at once, breaking them only at the ones to escape
+        size_t run_begin = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            const std::string_view escaped = JsonEscape(text[i]);
+            if (!escaped.empty()) {
+                out_.append(text.substr(run_begin, i - run_begin)).append(escaped);
+                run_begin = i + 1;
+            }
+        }
+        out_.append(text.substr(run_begin));
+        return *this;
     }
 
-    void Polyline::RenderObject(const RenderContext& context) const {
-        auto& out = context.out;
-        out << "<polyline points=\\\""sv;
-        for (int i = 0; i < GetSize(); i++) {
-            if (i == GetSize() - 1) {
-                out << (points_[i]).x << "," << (points_[i]).y;
+    Writer& Writer::Append(char c) {
+        const std::string_view escaped = escaping_ == Escaping::JSON ? JsonEscape(c) : std::string_view{};
+        if (escaped.empty()) {
+            out_.push_back(c);
+        }
+        else {
+            out_.append(escaped);
+        }
+        return *this;
+    }
+
+    Writer& Writer::AppendNumber(double value) {
+        // Six significant digits in the shortest notation, as std::ostream prints by default
+        char buffer[32];
+        const auto result = std::to_chars(std::begin(buffer), std::end(buffer), value, std::chars_format::general, 6);
+        out_.append(buffer, result.ptr);
+        return *this;
+    }
+
+    Writer& Writer::AppendNumber(uint32_t value) {
+        char buffer[16];
+        const auto result = std::to_chars(std::begin(buffer), std::end(buffer), value);
+        out_.append(buffer, result.ptr);
+        return *this;
+    }
+
+    namespace detail {
+
+        void AppendValue(Writer& out, double value) {
+            out.AppendNumber(value);
+        }
+
+        void AppendValue(Writer& out, const Color& color) {
+            if (std::holds_alternative<std::monostate>(color)) {
+                out.Append("none"sv);
             }
-            else {
-                out << (points_[i]).x << "," << (points_[i]).y << " ";
+            else if (const auto* str = std::get_if<std::string>(&color)) {
+                out.Append(*str);
+            }
+            else if (const auto* rgb = std::get_if<Rgb>(&color)) {
+                out.Append("rgb("sv);
+                out.AppendNumber(uint32_t{ rgb->red });
+                out.Append(',');
+                out.AppendNumber(uint32_t{ rgb->green });
+                out.Append(',');
+                out.AppendNumber(uint32_t{ rgb->blue });
+                out.Append(')');
+            }
+            else if (const auto* rgba = std::get_if<Rgba>(&color)) {
+                out.Append("rgba("sv);
+                out.AppendNumber(uint32_t{ rgba->red });
+                out.Append(',');
+                out.AppendNumber(uint32_t{ rgba->green });
+                out.Append(',');
+                out.AppendNumber(uint32_t{ rgba->blue });
+                out.Append(',');
+                out.AppendNumber(rgba->opacity);
+                out.Append(')');
+            }
+        }
+
+        void AppendValue(Writer& out, StrokeLineCap line_cap) {
+            switch (line_cap) {
+            case StrokeLineCap::BUTT:
+                out.Append("butt"sv);
+                break;
+            case StrokeLineCap::ROUND:
+                out.Append("round"sv);
+                break;
+            case StrokeLineCap::SQUARE:
+                out.Append("square"sv);
+                break;
+            }
+        }
+
+        void AppendValue(Writer& out, StrokeLineJoin line_join) {
+            switch (line_join) {
+            case StrokeLineJoin::ARCS:
+                out.Append("arcs"sv);
+                break;
+            case StrokeLineJoin::BEVEL:
+                out.Append("bevel"sv);
+                break;
+            case StrokeLineJoin::MITER:
+                out.Append("miter"sv);
+                break;
+            case StrokeLineJoin::MITER_CLIP:
+                out.Append("miter-clip"sv);
+                break;
+            case StrokeLineJoin::ROUND:
+                out.Append("round"sv);
+                break;
             }
         }
-        out << "\\\""sv;
-        RenderAttrs(context.out);
-        out << "/>\\n"sv;
+
+    } // namespace detail
+
+    void Circle::RenderTo(Writer& out) const {
+        out.Append("<circle cx=\""sv);
+        out.AppendNumber(center_.x);
+        out.Append("\" cy=\""sv);
+        out.AppendNumber(center_.y);
+        out.Append("\" r=\""sv);
+        out.AppendNumber(radius_);
+        out.Append("\" "sv);
+        RenderAttrs(out);
+        out.Append("/>\n"sv);
     }
 
-    void Text::RenderObject(const RenderContext& context) const {
-        auto& out = context.out;
-        out << "<text";
-        RenderAttrs(context.out);
-        out << " x=\\\""sv << pos_.x << "\\\" y=\\\""sv << pos_.y << "\\\" "sv; //  _<text x="35" y="20" _
-        out << "dx=\\\""sv << offset_.x << "\\\" dy=\\\""sv << offset_.y << "\\\" "sv; // _dx="0" dy="6" _
-        out << "font-size=\\\""sv << font_size_ << "\\\""; // _font-size="12"_
-        if (font_family_ != "") {
-            out << " font-family=\\\""sv << font_family_ << "\\\""; // _ font-family="Verdana"_
+    void Circle::RenderObject(const RenderContext& context) const {
+        std::string buffer;
+        Writer writer(buffer);
+        RenderTo(writer);
+        context.out << buffer;
+    }
+
+    void Polyline::RenderTo(Writer& out) const {
+        out.Append("<polyline points=\""sv);
+        for (size_t i = 0; i < points_.size(); i++) {
+            if (i > 0) {
+                out.Append(' ');
+            }
+            out.AppendNumber(points_[i].x);
+            out.Append(',');
+            out.AppendNumber(points_[i].y);
         }
-        if (font_weight_ != "") {
-            out << " font-weight=\\\""sv << font_weight_ << "\\\""; // _ font-weight="bold"
+        out.Append("\""sv);
+        RenderAttrs(out);
+        out.Append("/>\n"sv);
+    }
+
+    void Polyline::RenderObject(const RenderContext& context) const {
+        std::string buffer;
+        Writer writer(buffer);
+        RenderTo(writer);
+        context.out << buffer;
+    }
+
+    void Text::RenderTo(Writer& out) const {
+        out.Append("<text"sv);
+        RenderAttrs(out);
+        out.Append(" x=\""sv); //  _<text x="35" y="20" _
+        out.AppendNumber(pos_.x);
+        out.Append("\" y=\""sv);
+        out.AppendNumber(pos_.y);
+        out.Append("\" dx=\""sv); // _dx="0" dy="6" _
+        out.AppendNumber(offset_.x);
+        out.Append("\" dy=\""sv);
+        out.AppendNumber(offset_.y);
+        out.Append("\" font-size=\""sv); // _font-size="12"_
+        out.AppendNumber(font_size_);
+        out.Append("\""sv);
+        if (!font_family_.empty()) {
+            out.Append(" font-family=\""sv).Append(font_family_).Append("\""sv); // _ font-family="Verdana"_
+        }
+        if (!font_weight_.empty()) {
+            out.Append(" font-weight=\""sv).Append(font_weight_).Append("\""sv); // _ font-weight="bold"
         }
-        out << ">"sv << data_; // _font-weight="bold">Hello C++_
-        out << "</text>\\n"sv;
+        out.Append('>');
+        out.Append(data_); // _font-weight="bold">Hello C++_
+        out.Append("</text>\n"sv);
     }
 
-    void Document::Render(std::ostream& out) const {
-        out << "<?xml version=\\\"1.0\\\" encoding=\\\"UTF-8\\\" ?>\\n"sv;
-        out << "<svg xmlns=\\\"http://www.w3.org/2000/svg\\\" version=\\\"1.1\\\">\\n"sv;
-        for (size_t i = 0; i < store_.size(); i++) {
-            //out << "It is size " << store_.size() << std::endl;
-            RenderContext cont(out, 0, 2);
-            (store_[i])->Render(cont);
+    void Text::RenderObject(const RenderContext& context) const {
+        std::string buffer;
+        Writer writer(buffer);
+        RenderTo(writer);
+        context.out << buffer;
+    }
+
+    void Document::Add(Circle circle) {
+        order_.push_back({ ObjectKind::CIRCLE, circles_.size() });
+        circles_.push_back(std::move(circle));
+    }
+
+    void Document::Add(Polyline polyline) {
+        order_.push_back({ ObjectKind::POLYLINE, polylines_.size() });
+        polylines_.push_back(std::move(polyline));
+    }
+
+    void Document::Add(Text text) {
+        order_.push_back({ ObjectKind::TEXT, texts_.size() });
+        texts_.push_back(std::move(text));
+    }
+
+    namespace {
+
+        constexpr std::string_view DOCUMENT_HEADER = "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"
+                                                     "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">\n"sv;
+        constexpr std::string_view DOCUMENT_FOOTER = "</svg>"sv;
+        constexpr std::string_view OBJECT_INDENT = "  "sv;
+        // Typical size of a rendered tag, to reserve the buffer once
+        constexpr size_t OBJECT_SIZE_ESTIMATE = 192;
+
+    } // namespace
+
+    void Document::RenderObjects(Writer& out) const {
+        out.Reserve(order_.size() * OBJECT_SIZE_ESTIMATE);
+        for (const auto& [kind, index] : order_) {
+            out.Append(OBJECT_INDENT);
+            switch (kind) {
+            case ObjectKind::CIRCLE:
+                circles_[index].RenderTo(out);
+                break;
+            case ObjectKind::POLYLINE:
+                polylines_[index].RenderTo(out);
+                break;
+            case ObjectKind::TEXT:
+                texts_[index].RenderTo(out);
+                break;
+            case ObjectKind::OTHER: {
+                std::ostringstream object_out;
+                others_[index]->Render(RenderContext(object_out));
+                out.Append(object_out.str());
+                break;
+            }
+            }
         }
-        out << "</svg>"sv;
     }
 
-}  // namespace svg
\ No newline at end of file
+    void Document::Render(std::string& out, Escaping escaping) const {
+        Writer writer(out, escaping);
+        writer.Append(DOCUMENT_HEADER);
+        RenderObjects(writer);
+        writer.Append(DOCUMENT_FOOTER);
+    }
+
+    void Document::Render(std::ostream& out) const {
+        std::string buffer;
+        Render(buffer);
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    }
+
+}  // namespace svg
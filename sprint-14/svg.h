@@ -82,6 +82,47 @@ namespace svg {
 
     std::ostream& operator<<(std::ostream& os, const StrokeLineJoin& line);
 
+    // How markup is written out: as plain SVG, or escaped to be embedded into a JSON string
+    enum class Escaping {
+        NONE,
+        JSON,
+    };
+
+    /*
+     * Appends markup to a byte buffer, escaping it on the fly, so that a document embedded into
+     * a JSON response is written in one pass with no intermediate copy
+     */
+    class Writer {
+    public:
+        explicit Writer(std::string& out, Escaping escaping = Escaping::NONE)
+            : out_(out)
+            , escaping_(escaping) {
+        }
+
+        Writer& Append(std::string_view text);
+        Writer& Append(char c);
+        // Numbers look the same as with std::ostream defaults and never need escaping
+        Writer& AppendNumber(double value);
+        Writer& AppendNumber(uint32_t value);
+
+        void Reserve(size_t size) {
+            out_.reserve(out_.size() + size);
+        }
+
+    private:
+        std::string& out_;
+        Escaping escaping_;
+    };
+
+    namespace detail {
+
+        void AppendValue(Writer& out, double value);
+        void AppendValue(Writer& out, const Color& color);
+        void AppendValue(Writer& out, StrokeLineCap line_cap);
+        void AppendValue(Writer& out, StrokeLineJoin line_join);
+
+    } // namespace detail
+
     template <typename Owner>
     class PathProps {
     public:
@@ -112,13 +153,13 @@ namespace svg {
     protected:
         ~PathProps() = default;
 
-        void RenderAttrs(std::ostream& out) const {
+        void RenderAttrs(Writer& out) const {
             using namespace std::literals;
-            RenderAttrAccessory(out, " fill=\\\""s, fill_color_);
-            RenderAttrAccessory(out, " stroke=\\\""s, stroke_color_);
-            RenderAttrAccessory(out, " stroke-width=\\\""s, stroke_width_);
-            RenderAttrAccessory(out, " stroke-linecap=\\\""s, stroke_linecap_);
-            RenderAttrAccessory(out, " stroke-linejoin=\\\""s, stroke_linejoin_);
+            RenderAttrAccessory(out, " fill=\""sv, fill_color_);
+            RenderAttrAccessory(out, " stroke=\""sv, stroke_color_);
+            RenderAttrAccessory(out, " stroke-width=\""sv, stroke_width_);
+            RenderAttrAccessory(out, " stroke-linecap=\""sv, stroke_linecap_);
+            RenderAttrAccessory(out, " stroke-linejoin=\""sv, stroke_linejoin_);
         }
 
     private:
@@ -127,10 +168,12 @@ namespace svg {
         }
 
         template <typename type>
-        void RenderAttrAccessory(std::ostream& out, const std::string& line, const type& attr) const {
+        void RenderAttrAccessory(Writer& out, std::string_view line, const type& attr) const {
             using namespace std::literals;
             if (attr) {
-                out << line << *attr << "\\\""sv;
+                out.Append(line);
+                detail::AppendValue(out, *attr);
+                out.Append("\""sv);
             }
         }
 
@@ -202,6 +245,8 @@ namespace svg {
     public:
         Circle& SetCenter(Point center);
         Circle& SetRadius(double radius);
+        // Appends the tag without indentation
+        void RenderTo(Writer& out) const;
 
     private:
         void RenderObject(const RenderContext& context) const override;
@@ -226,8 +271,11 @@ namespace svg {
             return points_.size();
         }
 
+        // Appends the tag without indentation
+        void RenderTo(Writer& out) const;
+
     private:
-        std::deque<Point> points_ = {};
+        std::vector<Point> points_ = {};
 
         void RenderObject(const RenderContext& context) const override;
 
@@ -279,6 +327,9 @@ namespace svg {
             return pos_;
         }
 
+        // Appends the tag without indentation
+        void RenderTo(Writer& out) const;
+
     private:
         Point pos_;
         Point offset_;
@@ -308,18 +359,44 @@ namespace svg {
 
     };
 
+    /*
+     * Circles, polylines and texts are kept by value in arrays of their own type and rendered straight
+     * into a byte buffer; objects of other types added through AddPtr keep going through std::ostream
+     */
     class Document : public ObjectContainer {
     public:
+        using ObjectContainer::Add;
+
         // Äîáàâëÿåò â svg-äîêóìåíò îáúåêò-íàñëåäíèê svg::Object
         void AddPtr(std::unique_ptr<Object>&& obj) override {
-            store_.emplace_back(std::move(obj));
+            order_.push_back({ ObjectKind::OTHER, others_.size() });
+            others_.emplace_back(std::move(obj));
         }
+        void Add(Circle circle);
+        void Add(Polyline polyline);
+        void Add(Text text);
 
         // Âûâîäèò â ostream svg-ïðåäñòàâëåíèå äîêóìåíòà
         void Render(std::ostream& out) const;
+        // Appends the document to out, escaped for a JSON string if asked to
+        void Render(std::string& out, Escaping escaping = Escaping::NONE) const;
 
     private:
-        std::deque<std::unique_ptr<Object>> store_ = {};
+        enum class ObjectKind : uint8_t {
+            CIRCLE,
+            POLYLINE,
+            TEXT,
+            OTHER,
+        };
+
+        // Objects in the order they were added, as indexes into the arrays of their kind
+        std::vector<std::pair<ObjectKind, size_t>> order_;
+        std::vector<Circle> circles_;
+        std::vector<Polyline> polylines_;
+        std::vector<Text> texts_;
+        std::vector<std::unique_ptr<Object>> others_;
+
+        void RenderObjects(Writer& out) const;
     };
 
 }  // namespace svg
\ No newline at end of file
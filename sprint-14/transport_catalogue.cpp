@@ -1,105 +1,406 @@
 #include "transport_catalogue.h"
+#include "parallel.h"
 
+#include <algorithm>
 #include <numeric>
-#include <unordered_set>
 #include <iomanip>
 #include <iostream>
+#include <stdexcept>
 
 namespace TransportCatalogue {
 
     using namespace std::literals;
 
+    namespace {
+
+        // Binary search over ids sorted by name and then by id, so that the first of equal names is found
+        // as in a hash table filled in id order. The order isn't checked in full, so ids out of range never match
+        template <typename Records, typename GetName>
+        std::optional<uint32_t> FindInNameOrder(const ranges::StoredArray<uint32_t>& order, const Records& records,
+                                                GetName get_name, std::string_view name) {
+            const auto it = std::lower_bound(order.begin(), order.end(), name, [&](uint32_t id, std::string_view value) {
+                return id < records.size() && std::string_view(get_name(records[id])) < value;
+            });
+            if (it == order.end() || *it >= records.size() || get_name(records[*it]) != name) {
+                return std::nullopt;
+            }
+            return *it;
+        }
+
+        std::string_view GetStopName(const Stop& stop) {
+            return stop.name_stop;
+        }
+
+        std::string_view GetBusName(const Bus& bus) {
+            return bus.name_bus;
+        }
+
+    } //namespace
+
     void TransportCatalogue::AddStop(std::string_view name, geo::Coordinates coordinates_) {
-        stops_.push_back({ name, std::move(coordinates_) });
-        const Stop* st = &stops_[stops_.size() - 1];
-        names_stops_.insert({ (*st).name_stop , std::move(st) });
-        buses_for_stops_[(*st).name_stop];
+        AddStopInPlace(names_.emplace_back(name), coordinates_);
+    }
+
+    void TransportCatalogue::AddStopInPlace(std::string_view name, geo::Coordinates coordinates_) {
+        const StopId id = static_cast<StopId>(stops_.size());
+        stops_.push_back({ name, coordinates_ });
+        Stop& st = stops_.back();
+        st.id = id;
+        if (use_name_order_ && stops_.size() > stops_by_name_.size()) {
+            DropNameOrder();
+        }
+        else if (!use_name_order_) {
+            names_stops_.insert({ st.name_stop, id });
+        }
+        stop_buses_outdated_ = true;
+        latitudes_.push_back(coordinates_.lat);
+        longitudes_.push_back(coordinates_.lng);
     }
 
     void TransportCatalogue::AddBus(std::string_view name, bool loop, const std::vector<std::string>& stops_buses) {
-        int num_stops = static_cast<int>(stops_buses.size());
-        Bus bus(name, loop, { (loop) ? num_stops : (num_stops * 2 - 1), GetUniqueStops(stops_buses) });
-        buses_.push_back(std::move(bus));
-        const Bus* st = &buses_[buses_.size() - 1];
-        (names_buses_).insert({ (*st).name_bus , std::move(st) });
-        ((buses_[buses_.size() - 1]).stops_for_bus_).reserve(stops_buses.size());
+        std::vector<StopId> route;
+        route.reserve(stops_buses.size());
         for (std::string_view stop_ : stops_buses) {
-            ((buses_[buses_.size() - 1]).stops_for_bus_).push_back(names_stops_.at(stop_)->name_stop);
-            (buses_for_stops_.at(stop_)).insert(buses_[buses_.size() - 1].name_bus);
+            const std::optional<StopId> stop = FindStopId(stop_);
+            if (!stop) {
+                throw std::out_of_range("Stop is not found");
+            }
+            route.push_back(*stop);
+        }
+        AddBus(name, loop, std::move(route));
+    }
+
+    void TransportCatalogue::AddBus(std::string_view name, bool loop, std::vector<StopId> route) {
+        CheckRoute({ route.data(), route.data() + route.size() });
+        const std::vector<StopId>& stored = routes_.emplace_back(std::move(route));
+        const RouteRange stored_route{ stored.data(), stored.data() + stored.size() };
+        AddCheckedBus(names_.emplace_back(name), loop, stored_route, CountStops(stored_route, loop));
+    }
+
+    void TransportCatalogue::AddBus(std::string_view name, bool loop, RouteRange route) {
+        CheckRoute(route);
+        AddCheckedBus(names_.emplace_back(name), loop, route, CountStops(route, loop));
+    }
+
+    void TransportCatalogue::AddBusInPlace(std::string_view name, bool loop, RouteRange route, BusStaticInformation counts) {
+        CheckRoute(route);
+        AddCheckedBus(name, loop, route, counts);
+    }
+
+    void TransportCatalogue::AddCheckedBus(std::string_view name, bool loop, RouteRange route, BusStaticInformation counts) {
+        const BusId id = static_cast<BusId>(buses_.size());
+        buses_.push_back(Bus(name, loop, counts));
+        Bus& bus = buses_.back();
+        bus.id = id;
+        bus.route = route;
+        if (use_name_order_ && buses_.size() > buses_by_name_.size()) {
+            DropNameOrder();
+        }
+        else if (!use_name_order_) {
+            names_buses_.insert({ bus.name_bus, id });
+        }
+        stop_buses_outdated_ = true;
+        bus_statistics_outdated_ = true;
+    }
+
+    void TransportCatalogue::CheckRoute(RouteRange route) const {
+        for (StopId stop : route) {
+            if (stop >= stops_.size()) {
+                throw std::out_of_range("Stop is out of range");
+            }
         }
+    }
 
+    void TransportCatalogue::UseNameOrder(ranges::StoredArray<StopId> stops_by_name, ranges::StoredArray<BusId> buses_by_name) {
+        stops_by_name_ = std::move(stops_by_name);
+        buses_by_name_ = std::move(buses_by_name);
+        use_name_order_ = true;
+        if (!stops_.empty() || !buses_.empty()) {
+            CheckNameOrder();
+        }
+    }
+
+    void TransportCatalogue::CheckNameOrder() {
+        if (use_name_order_ && (stops_by_name_.size() != stops_.size() || buses_by_name_.size() != buses_.size())) {
+            DropNameOrder();
+        }
+    }
+
+    void TransportCatalogue::DropNameOrder() {
+        use_name_order_ = false;
+        stops_by_name_ = {};
+        buses_by_name_ = {};
+        names_stops_.clear();
+        names_buses_.clear();
+        names_stops_.reserve(stops_.size());
+        for (const Stop& stop : stops_) {
+            names_stops_.insert({ stop.name_stop, stop.id });
+        }
+        names_buses_.reserve(buses_.size());
+        for (const Bus& bus : buses_) {
+            names_buses_.insert({ bus.name_bus, bus.id });
+        }
+    }
+
+    std::optional<StopId> TransportCatalogue::FindStopId(std::string_view name) const {
+        if (use_name_order_) {
+            return FindInNameOrder(stops_by_name_, stops_, GetStopName, name);
+        }
+        const auto it = names_stops_.find(name);
+        if (it == names_stops_.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    std::optional<BusId> TransportCatalogue::FindBusId(std::string_view name) const {
+        if (use_name_order_) {
+            return FindInNameOrder(buses_by_name_, buses_, GetBusName, name);
+        }
+        const auto it = names_buses_.find(name);
+        if (it == names_buses_.end()) {
+            return std::nullopt;
+        }
+        return it->second;
     }
 
     const Bus* TransportCatalogue::FindBus(std::string_view name) const {
-        return names_buses_.at(name);
+        const std::optional<BusId> bus = FindBusId(name);
+        if (!bus) {
+            throw std::out_of_range("Bus is not found");
+        }
+        return &buses_[*bus];
     }
 
     const Stop* TransportCatalogue::FindStop(std::string_view name) const {
-        return names_stops_.at(name);
+        const std::optional<StopId> stop = FindStopId(name);
+        if (!stop) {
+            throw std::out_of_range("Stop is not found");
+        }
+        return &stops_[*stop];
     }
 
     detail::InformationBus TransportCatalogue::GetInformationBus(std::string_view name) const {
-        if (names_buses_.count(name) == 0) {
+        const std::optional<BusId> bus = FindBusId(name);
+        if (!bus) {
             return {};
         }
-        int distance = ComputeRealDistanceBus(name);
-        return { (*FindBus(name)).static_infom, distance, static_cast<double>(distance) / ComputeStraightDistanceBus(name) };
+        return GetInformationBus(*bus);
     }
 
-    std::pair<bool, std::set<std::string>> TransportCatalogue::GetInformationStop(std::string_view name) const {
-        if (names_stops_.count(name) == 0) {
-            return { false, {} };
+    detail::InformationBus TransportCatalogue::GetInformationBus(BusId bus) const {
+        if (bus_statistics_outdated_) {
+            return ComputeInformationBus(bus);
         }
-        return { true, buses_for_stops_.at(std::string(name)) };
+        return bus_statistics_[bus];
+    }
+
+    detail::InformationBus TransportCatalogue::ComputeInformationBus(BusId bus) const {
+        int distance = ComputeRealDistanceBus(bus);
+        return { buses_[bus].static_infom, distance, static_cast<double>(distance) / ComputeStraightDistanceBus(bus) };
+    }
+
+    std::pair<bool, TransportCatalogue::BusesRange> TransportCatalogue::GetInformationStop(std::string_view name) const {
+        const std::optional<StopId> stop = FindStopId(name);
+        if (!stop) {
+            return { false, { buses_for_stops_.end(), buses_for_stops_.end() } };
+        }
+        if (*stop + 1 >= stop_buses_offsets_.size()) {
+            // The stop was added after the last Finalize()
+            return { true, { buses_for_stops_.end(), buses_for_stops_.end() } };
+        }
+        return { true, { buses_for_stops_.begin() + stop_buses_offsets_[*stop],
+                         buses_for_stops_.begin() + stop_buses_offsets_[*stop + 1] } };
     }
 
     void TransportCatalogue::SetDistance(const std::string& from_, const std::string& where_, int distance_) {
-        distances_[{FindStop(std::string_view(from_)), FindStop(where_)}] = distance_;
+        SetDistance(FindStop(from_)->id, FindStop(where_)->id, distance_);
+    }
+
+    void TransportCatalogue::SetDistance(StopId from, StopId to, int distance) {
+        if (from >= stops_.size() || to >= stops_.size()) {
+            throw std::out_of_range("Stop is out of range");
+        }
+        pending_distances_.emplace_back(from, to, distance);
+        bus_statistics_outdated_ = true;
+    }
+
+    void TransportCatalogue::RestoreDistances(ranges::StoredArray<uint32_t> offsets, ranges::StoredArray<DistanceEntry> distances) {
+        if (offsets.size() != stops_.size() + 1 || offsets[0] != 0 || offsets.back() != distances.size()) {
+            throw std::invalid_argument("Distance index doesn't match the stops");
+        }
+        distance_offsets_ = std::move(offsets);
+        distances_ = std::move(distances);
+        pending_distances_.clear();
+        bus_statistics_outdated_ = true;
+    }
+
+    void TransportCatalogue::Finalize() {
+        CheckNameOrder();
+        BuildDistanceIndex();
+        if (stop_buses_outdated_) {
+            BuildStopBusesIndex();
+        }
+        if (bus_statistics_outdated_) {
+            ComputeBusStatistics();
+        }
+    }
+
+    void TransportCatalogue::RestoreBusStatistics(std::vector<detail::InformationBus> statistics) {
+        if (statistics.size() != buses_.size()) {
+            return;
+        }
+        bus_statistics_ = std::move(statistics);
+        bus_statistics_outdated_ = false;
+    }
+
+    void TransportCatalogue::ComputeBusStatistics() {
+        // Distances must already be in the CSR index: workers only read it
+        std::vector<detail::InformationBus> statistics(buses_.size());
+        parallel::ParallelFor(buses_.size(), [this, &statistics](size_t bus) {
+            statistics[bus] = ComputeInformationBus(static_cast<BusId>(bus));
+        });
+        bus_statistics_ = std::move(statistics);
+        bus_statistics_outdated_ = false;
+    }
+
+    void TransportCatalogue::BuildStopBusesIndex() {
+        std::vector<BusId> buses_by_name;
+        if (use_name_order_) {
+            buses_by_name.assign(buses_by_name_.begin(), buses_by_name_.end());
+        }
+        else {
+            buses_by_name.resize(buses_.size());
+            std::iota(buses_by_name.begin(), buses_by_name.end(), BusId{ 0 });
+            std::sort(buses_by_name.begin(), buses_by_name.end(), [this](BusId lhs, BusId rhs) {
+                return buses_[lhs].name_bus < buses_[rhs].name_bus;
+            });
+        }
+
+        // Two passes over the routes: count buses per stop, then fill the slots. A bus visiting
+        // a stop several times is recorded once, since its last recorded bus is remembered per stop
+        const BusId no_bus = static_cast<BusId>(buses_.size());
+        std::vector<BusId> last_bus(stops_.size(), no_bus);
+        stop_buses_offsets_.assign(stops_.size() + 1, 0);
+        for (BusId bus : buses_by_name) {
+            for (StopId stop : buses_[bus].route) {
+                if (last_bus[stop] != bus) {
+                    last_bus[stop] = bus;
+                    ++stop_buses_offsets_[stop + 1];
+                }
+            }
+        }
+        std::partial_sum(stop_buses_offsets_.begin(), stop_buses_offsets_.end(), stop_buses_offsets_.begin());
+
+        buses_for_stops_.assign(stop_buses_offsets_.back(), 0);
+        std::vector<uint32_t> next_slot(stop_buses_offsets_.begin(), stop_buses_offsets_.end() - 1);
+        std::fill(last_bus.begin(), last_bus.end(), no_bus);
+        for (BusId bus : buses_by_name) {
+            for (StopId stop : buses_[bus].route) {
+                if (last_bus[stop] != bus) {
+                    last_bus[stop] = bus;
+                    buses_for_stops_[next_slot[stop]++] = bus;
+                }
+            }
+        }
+        stop_buses_outdated_ = false;
+    }
+
+    void TransportCatalogue::BuildDistanceIndex() {
+        if (pending_distances_.empty()) {
+            return;
+        }
+        // Already indexed distances go first so that a repeated SetDistance overrides them
+        std::vector<std::tuple<StopId, StopId, int>> all_distances;
+        all_distances.reserve(distances_.size() + pending_distances_.size());
+        for (StopId from = 0; from + 1 < distance_offsets_.size(); ++from) {
+            for (const DistanceEntry& entry : GetDistancesFrom(from)) {
+                all_distances.emplace_back(from, entry.to, entry.distance);
+            }
+        }
+        all_distances.insert(all_distances.end(), pending_distances_.begin(), pending_distances_.end());
+        pending_distances_.clear();
+        pending_distances_.shrink_to_fit();
+
+        std::stable_sort(all_distances.begin(), all_distances.end(), [](const auto& lhs, const auto& rhs) {
+            return std::tie(std::get<0>(lhs), std::get<1>(lhs)) < std::tie(std::get<0>(rhs), std::get<1>(rhs));
+        });
+
+        std::vector<DistanceEntry> distances;
+        distances.reserve(all_distances.size());
+        std::vector<uint32_t> offsets(stops_.size() + 1, 0);
+        for (size_t i = 0; i < all_distances.size(); ++i) {
+            const auto& [from, to, distance] = all_distances[i];
+            const bool overridden = i + 1 < all_distances.size()
+                && std::get<0>(all_distances[i + 1]) == from && std::get<1>(all_distances[i + 1]) == to;
+            if (!overridden) {
+                distances.push_back({ to, distance });
+                ++offsets[from + 1];
+            }
+        }
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        distance_offsets_ = std::move(offsets);
+        distances_ = std::move(distances);
     }
 
     int TransportCatalogue::GetDistance(const Stop* stop1, const Stop* stop2) const {
-        if (distances_.count({ stop1, stop2 }) == 0) {
-            return 0;
+        return GetDistance(stop1->id, stop2->id);
+    }
+
+    int TransportCatalogue::GetDistance(StopId from, StopId to) const {
+        // Distances set after the last Finalize() aren't indexed yet; the latest one overrides the rest.
+        // A linear search, since queries are meant to follow Finalize()
+        const auto pending = std::find_if(pending_distances_.rbegin(), pending_distances_.rend(), [from, to](const auto& entry) {
+            return std::get<0>(entry) == from && std::get<1>(entry) == to;
+        });
+        if (pending != pending_distances_.rend()) {
+            return std::get<2>(*pending);
         }
-        return distances_.at({ stop1, stop2 });
+        const DistancesRange row = GetDistancesFrom(from);
+        const auto it = std::lower_bound(row.begin(), row.end(), to, [](const DistanceEntry& entry, StopId stop) {
+            return entry.to < stop;
+        });
+        return (it != row.end() && it->to == to) ? it->distance : 0;
     }
 
     int TransportCatalogue::GetDistanceInAnyDirection(std::string_view stop1, std::string_view stop2) const {
-        const Stop* st1 = FindStop(stop1);
-        const Stop* st2 = FindStop(stop2);
-        int dist = GetDistance(st1, st2);
+        return GetDistanceInAnyDirection(FindStop(stop1)->id, FindStop(stop2)->id);
+    }
+
+    int TransportCatalogue::GetDistanceInAnyDirection(StopId stop1, StopId stop2) const {
+        int dist = GetDistance(stop1, stop2);
         if (dist == 0) {
-            dist = GetDistance(st2, st1);
+            dist = GetDistance(stop2, stop1);
         }
         return dist;
     }
 
-    geo::Coordinates TransportCatalogue::GetCoordinates(std::string_view stop) const {
-        return{ (FindStop(stop)->coordinates).lat, (FindStop(stop)->coordinates).lng };
-    }
-
-    double TransportCatalogue::ComputeStraightDistanceBus(std::string_view name) const {
+    double TransportCatalogue::ComputeStraightDistanceBus(BusId bus) const {
         double itog = 0.00;
-        const std::vector<std::string_view>& stops = FindBus(name)->stops_for_bus_;
-        for (size_t i = 0; i < stops.size() - 1; i++) {
-
-            itog += ComputeDistance(GetCoordinates(stops[i]), GetCoordinates(stops[i + 1]));
+        const RouteRange stops = buses_[bus].route;
+        for (size_t i = 0; i + 1 < stops.size(); i++) {
+            itog += geo::ComputeDistance({ latitudes_[stops[i]], longitudes_[stops[i]] },
+                                         { latitudes_[stops[i + 1]], longitudes_[stops[i + 1]] });
         }
-        if (!(*FindBus(name)).looping) {
+        if (!buses_[bus].looping) {
             itog *= 2.00;
         }
         return itog;
     }
 
-    int TransportCatalogue::GetUniqueStops(const std::vector<std::string>& stops_buses) const {
-        return static_cast<int>(std::unordered_set<std::string_view>(stops_buses.begin(), stops_buses.end()).size());
+    BusStaticInformation TransportCatalogue::CountStops(RouteRange route, bool loop) const {
+        const int num_stops = static_cast<int>(route.size());
+        std::vector<StopId> sorted(route.begin(), route.end());
+        std::sort(sorted.begin(), sorted.end());
+        const int num_unique = static_cast<int>(std::unique(sorted.begin(), sorted.end()) - sorted.begin());
+        return { loop ? num_stops : (num_stops * 2 - 1), num_unique };
     }
 
-    int TransportCatalogue::ComputeRealDistanceBus(std::string_view name_bus) const {
+    int TransportCatalogue::ComputeRealDistanceBus(BusId bus) const {
         int result = 0;
-        const std::vector<std::string_view>& stops = FindBus(name_bus)->stops_for_bus_;
-        bool loop = (*FindBus(name_bus)).looping;
-        for (size_t i = 0; i < stops.size() - 1; i++) {
+        const RouteRange stops = buses_[bus].route;
+        bool loop = buses_[bus].looping;
+        for (size_t i = 0; i + 1 < stops.size(); i++) {
             result += GetDistanceInAnyDirection(stops[i], stops[i + 1]);
             if (!loop) {
                 result += GetDistanceInAnyDirection(stops[i + 1], stops[i]);
@@ -111,10 +412,10 @@ namespace TransportCatalogue {
     TransportCatalogue::BusesAndStops TransportCatalogue::InfoForMap() const {
         std::set<const Bus*, detail::BusHasher> buses_for_map;
         std::map<std::string_view, const Stop*> stops_for_map;
-        for (auto& elem : names_buses_) {
-            buses_for_map.insert(elem.second);
-            for (const auto& e : elem.second->stops_for_bus_) {
-                stops_for_map.insert({ e ,names_stops_.at(e) });
+        for (const Bus& bus : buses_) {
+            buses_for_map.insert(&bus);
+            for (StopId stop : bus.route) {
+                stops_for_map.insert({ stops_[stop].name_stop, &stops_[stop] });
             }
         }
         return make_pair(std::move(buses_for_map), std::move(stops_for_map));
@@ -128,8 +429,21 @@ namespace TransportCatalogue {
         return buses_;
     }
 
-    const std::unordered_map<std::pair<const Stop*, const Stop*>, int, detail::HasherPairStops>& TransportCatalogue::GetDistancesConst() const {
-        return distances_;
+    RouteRange TransportCatalogue::GetRoute(BusId bus) const {
+        return buses_[bus].route;
+    }
+
+    TransportCatalogue::DistancesRange TransportCatalogue::GetDistancesFrom(StopId from) const {
+        if (from + 1 >= distance_offsets_.size()) {
+            return {};
+        }
+        // A stored index is only checked for size when restored, so its rows are checked here
+        const uint32_t first = distance_offsets_[from];
+        const uint32_t last = distance_offsets_[from + 1];
+        if (first > last || last > distances_.size()) {
+            throw std::out_of_range("Distance index is damaged");
+        }
+        return { distances_.begin() + first, distances_.begin() + last };
     }
 
-}
\ No newline at end of file
+}
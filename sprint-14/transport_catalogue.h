@@ -8,49 +8,120 @@
 #include <vector>
 #include <utility>
 #include <map>
+#include <optional>
+#include <tuple>
 
 #include "geo.h"
 #include "domain.h"
+#include "ranges.h"
 
 namespace TransportCatalogue {
 
+    struct DistanceEntry {
+        StopId to = 0;
+        int distance = 0;
+    };
+
     class TransportCatalogue {
     public:
         using BusesAndStops = std::pair<std::set<const Bus*, detail::BusHasher>, std::map<std::string_view, const Stop*>>;
+        using DistancesRange = ranges::Range<const DistanceEntry*>;
+        using BusesRange = ranges::Range<std::vector<BusId>::const_iterator>;
+
         void AddStop(std::string_view name, geo::Coordinates coordinates_);
+        // Same, with the name used in place: it must outlive the catalogue, e.g. in a mapped base
+        void AddStopInPlace(std::string_view name, geo::Coordinates coordinates);
         void AddBus(std::string_view name, bool loop, const std::vector<std::string>& stops_buses);
+        // Same as above with the stops given by id, e.g. read from a serialized base
+        void AddBus(std::string_view name, bool loop, std::vector<StopId> route);
+        // Same, with the stops used in place: they must outlive the catalogue, e.g. in a mapped base
+        void AddBus(std::string_view name, bool loop, RouteRange route);
+        // Same, with the name used in place too and the stops counted beforehand, e.g. read from a mapped base
+        void AddBusInPlace(std::string_view name, bool loop, RouteRange route, BusStaticInformation counts);
         void SetDistance(const std::string& from_, const std::string& where_, int distance_);
+        void SetDistance(StopId from, StopId to, int distance);
+        // Replaces all distances with a ready CSR index, rows sorted by `to`, owned or kept alive by the caller.
+        // Only its size is checked here: throws std::invalid_argument if it doesn't fit the stops. A row out of
+        // bounds throws std::out_of_range when read, an unsorted one just gives wrong distances
+        void RestoreDistances(ranges::StoredArray<uint32_t> offsets, ranges::StoredArray<DistanceEntry> distances);
+        // Serves name lookups by binary search over ids sorted by name and then by id, e.g. stored in a flat base,
+        // instead of hash tables. Call on an empty catalogue before adding the stops and buses the ids refer to.
+        // The order is trusted, so an unsorted one only makes lookups miss; Finalize() drops an order of another
+        // size for the hash tables, and so do stops and buses added beyond it
+        void UseNameOrder(ranges::StoredArray<StopId> stops_by_name, ranges::StoredArray<BusId> buses_by_name);
+        // Moves the distances set so far into the CSR index, builds the stop-to-buses index
+        // and computes statistics of every bus in parallel; call after filling and before queries
+        void Finalize();
+        // Statistics read from a serialized base, indexed by BusId; Finalize() keeps them unless the catalogue changes afterwards
+        void RestoreBusStatistics(std::vector<detail::InformationBus> statistics);
 
         const Bus* FindBus(std::string_view name) const;
         const Stop* FindStop(std::string_view name) const;
 
+        // Distances set since the last Finalize() count too, though they are looked up linearly until it is called
         int GetDistance(const Stop* stop1, const Stop* stop2) const;
+        int GetDistance(StopId from, StopId to) const;
         int GetDistanceInAnyDirection(std::string_view stop1, std::string_view stop2) const;
+        int GetDistanceInAnyDirection(StopId stop1, StopId stop2) const;
 
         BusesAndStops InfoForMap() const;
         detail::InformationBus GetInformationBus(std::string_view name) const;
-        std::pair<bool, std::set<std::string>> GetInformationStop(std::string_view name) const;
+        detail::InformationBus GetInformationBus(BusId bus) const;
+        // Buses passing through the stop, ordered by name; the range points into the catalogue
+        std::pair<bool, BusesRange> GetInformationStop(std::string_view name) const;
 
         const std::deque<Stop>& GetStopsConst() const;
         const std::deque<Bus>& GetBusesConst() const;
-        const std::unordered_map<std::pair<const Stop*, const Stop*>, int, detail::HasherPairStops>& GetDistancesConst() const;
-        
+        RouteRange GetRoute(BusId bus) const;
+        DistancesRange GetDistancesFrom(StopId from) const;
+
     private:
         //õðàíåíèå îðèãèíàëîâ
         std::deque<Stop> stops_;
         std::deque<Bus> buses_;
+        // Names of stops and buses added by copy; a deque keeps them in place
+        std::deque<std::string> names_;
         //óêàçàòåëè ïî èìåíè
-        std::unordered_map<std::string_view, const Stop*> names_stops_;
-        std::unordered_map<std::string_view, const Bus*> names_buses_;
+        std::unordered_map<std::string_view, StopId> names_stops_;
+        std::unordered_map<std::string_view, BusId> names_buses_;
+        // Replace the hash tables while use_name_order_ is set, see UseNameOrder()
+        ranges::StoredArray<StopId> stops_by_name_;
+        ranges::StoredArray<BusId> buses_by_name_;
+        bool use_name_order_ = false;
         //íåîáõîäèìûå ñïèñêè
-        std::unordered_map<std::string_view, std::set<std::string>> buses_for_stops_; //ñïèñîê àâòîáóñîâ äëÿ êîíêðåòíîé îñòàíîâêè
-        std::unordered_map<std::pair<const Stop*, const Stop*>, int, detail::HasherPairStops> distances_; //ñïèñîê äèñòàíöèé äëÿ ïðîìåæóòêîâ
+        // Buses of stop i are buses_for_stops_[stop_buses_offsets_[i]..stop_buses_offsets_[i + 1]), ordered by bus name
+        std::vector<uint32_t> stop_buses_offsets_ = { 0 };
+        std::vector<BusId> buses_for_stops_; //ñïèñîê àâòîáóñîâ äëÿ êîíêðåòíîé îñòàíîâêè
+        bool stop_buses_outdated_ = false;
+        // Routes added as vectors; Bus::route points into them, and a deque keeps them in place
+        std::deque<std::vector<StopId>> routes_;
+        // Stop coordinates as separate arrays, indexed by StopId
+        std::vector<double> latitudes_;
+        std::vector<double> longitudes_;
+        // Distances in CSR form: entries from stop i are distances_[distance_offsets_[i]..distance_offsets_[i + 1]), sorted by `to`;
+        // stops added after the last Finalize() have no row yet
+        ranges::StoredArray<uint32_t> distance_offsets_ = std::vector<uint32_t>{ 0 };
+        ranges::StoredArray<DistanceEntry> distances_;
+        // Distances set after the last Finalize()
+        std::vector<std::tuple<StopId, StopId, int>> pending_distances_;
+        // Statistics of every bus computed by Finalize(), indexed by BusId
+        std::vector<detail::InformationBus> bus_statistics_;
+        bool bus_statistics_outdated_ = false;
 
-        geo::Coordinates GetCoordinates(std::string_view stop) const;
-        double ComputeStraightDistanceBus(std::string_view name) const;
-        int ComputeRealDistanceBus(std::string_view name_bus) const;
-        int GetUniqueStops(const std::vector<std::string>& stops_buses) const;
+        std::optional<StopId> FindStopId(std::string_view name) const;
+        std::optional<BusId> FindBusId(std::string_view name) const;
+        void CheckNameOrder();
+        void DropNameOrder();
+        void CheckRoute(RouteRange route) const;
+        void AddCheckedBus(std::string_view name, bool loop, RouteRange route, BusStaticInformation counts);
+        void BuildDistanceIndex();
+        void BuildStopBusesIndex();
+        void ComputeBusStatistics();
+        detail::InformationBus ComputeInformationBus(BusId bus) const;
+        double ComputeStraightDistanceBus(BusId bus) const;
+        int ComputeRealDistanceBus(BusId bus) const;
+        BusStaticInformation CountStops(RouteRange route, bool loop) const;
 
     };
 
-}//namespace TransportCatalogue
\ No newline at end of file
+}//namespace TransportCatalogue
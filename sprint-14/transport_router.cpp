@@ -10,17 +10,34 @@ namespace TransportCatalogue {
 
 		void TransportRouter::FillGraph() {
 			auto [buses, stops] = catalogue_.InfoForMap();
-			graph_.SetVertexCount(stops.size());
 			FillStopsVertexes(stops);
-			edges_.reserve(stops.size() * stops.size());
+			if (settings_.graph_model_ == GraphModel::TRANSFER_NODES) {
+				FillTransferGraph(buses, stops.size());
+			}
+			else {
+				FillStopPairsGraph(buses, stops.size());
+			}
+			graph_.Freeze();
+		}
+
+		void TransportRouter::FillStopPairsGraph(const std::set<const Bus*, detail::BusHasher>& buses, size_t stop_count) {
+			graph_.SetVertexCount(stop_count);
+			size_t edge_count = 0;
 			for (const Bus* route : buses) {
-				size_t size = route->stops_for_bus_.size();
+				const size_t size = route->route.size();
+				edge_count += (route->looping ? 1u : 2u) * size * (size - std::min<size_t>(size, 1u)) / 2u;
+			}
+			edges_.reserve(edge_count);
+			const std::deque<Stop>& stops = catalogue_.GetStopsConst();
+			for (const Bus* route : buses) {
+				const RouteRange ids = route->route;
+				size_t size = ids.size();
 				if (route->looping) {
 					for (size_t i = 0; i < size - 1; i++) {
 						double weight = 0.0;
 						for (size_t j = i + 1u; j < size; j++) {
-							weight += static_cast<double>(catalogue_.GetDistanceInAnyDirection(route->stops_for_bus_[j - 1u], route->stops_for_bus_[j]));
-							AddRouteEdge({ 0, route->stops_for_bus_[i], route->name_bus, (j - i), weight }, route->stops_for_bus_[j]);
+							weight += static_cast<double>(catalogue_.GetDistanceInAnyDirection(ids[j - 1u], ids[j]));
+							AddRouteEdge({ 0, stops[ids[i]].name_stop, route->name_bus, (j - i), weight }, stops[ids[j]].name_stop);
 						}
 					}
 				}
@@ -29,17 +46,55 @@ namespace TransportCatalogue {
 						double weight_forward = 0.0;
 						double weight_back = 0.0;
 						for (size_t j = i + 1u; j < size; j++) {
-							weight_forward += static_cast<double>(catalogue_.GetDistanceInAnyDirection(route->stops_for_bus_[j - 1u], route->stops_for_bus_[j]));
-							AddRouteEdge({ 0, route->stops_for_bus_[i], route->name_bus, (j - i), weight_forward }, route->stops_for_bus_[j]);
+							weight_forward += static_cast<double>(catalogue_.GetDistanceInAnyDirection(ids[j - 1u], ids[j]));
+							AddRouteEdge({ 0, stops[ids[i]].name_stop, route->name_bus, (j - i), weight_forward }, stops[ids[j]].name_stop);
 
-							weight_back += static_cast<double>(catalogue_.GetDistanceInAnyDirection(route->stops_for_bus_[j], route->stops_for_bus_[j - 1u]));
-							AddRouteEdge({ 0, route->stops_for_bus_[j], route->name_bus, (j - i), weight_back }, route->stops_for_bus_[i]);
+							weight_back += static_cast<double>(catalogue_.GetDistanceInAnyDirection(ids[j], ids[j - 1u]));
+							AddRouteEdge({ 0, stops[ids[j]].name_stop, route->name_bus, (j - i), weight_back }, stops[ids[i]].name_stop);
 						}
 					}
 				}
 			}
 		}
 
+		void TransportRouter::FillTransferGraph(const std::set<const Bus*, detail::BusHasher>& buses, size_t stop_count) {
+			size_t vertex_count = stop_count;
+			for (const Bus* route : buses) {
+				vertex_count += (route->looping ? 1u : 2u) * route->route.size();
+			}
+			graph_.SetVertexCount(vertex_count);
+			edges_.reserve(3u * (vertex_count - stop_count));
+
+			graph::VertexId next_vertex = stop_count;
+			for (const Bus* route : buses) {
+				AddRideChain(route, false, next_vertex);
+				next_vertex += route->route.size();
+				if (!route->looping) {
+					AddRideChain(route, true, next_vertex);
+					next_vertex += route->route.size();
+				}
+			}
+		}
+
+		void TransportRouter::AddRideChain(const Bus* route, bool reversed, graph::VertexId first_vertex) {
+			const RouteRange ids = route->route;
+			const size_t size = ids.size();
+			for (size_t k = 0; k < size; k++) {
+				const size_t position = reversed ? size - 1u - k : k;
+				const std::string_view stop = catalogue_.GetStopsConst()[ids[position]].name_stop;
+				const graph::VertexId vertex = first_vertex + k;
+				if (k > 0) {
+					const size_t previous = reversed ? position + 1u : position - 1u;
+					const double distance = static_cast<double>(catalogue_.GetDistanceInAnyDirection(ids[previous], ids[position]));
+					AddTransferEdge({ 0, stop, route->name_bus, 1, distance / settings_.bus_velocity_m_m_, EdgeKind::RIDE }, vertex - 1u, vertex);
+					AddTransferEdge({ 0, stop, route->name_bus, 0, 0.0, EdgeKind::ALIGHT }, vertex, vertexes_.at(stop));
+				}
+				if (k + 1u < size) {
+					AddTransferEdge({ 0, stop, route->name_bus, 0, settings_.bus_wait_time_, EdgeKind::BOARD }, vertexes_.at(stop), vertex);
+				}
+			}
+		}
+
 		void TransportRouter::SetSettings(BusTimesSettings&& settings) {
 			settings_ = std::move(settings);
 		}
@@ -48,11 +103,78 @@ namespace TransportCatalogue {
 			return settings_;
 		}
 
+		void TransportRouter::SetRouterMode(graph::RouterMode mode) {
+			router_mode_ = mode;
+		}
+
+		graph::RouterMode TransportRouter::GetRouterMode() const {
+			return router_mode_;
+		}
+
+		void TransportRouter::SetContractionHierarchyData(graph::ContractionHierarchy<double>::Data&& data) {
+			hierarchy_data_ = std::move(data);
+		}
+
+		void TransportRouter::SetAllPairsData(graph::Router<double>::AllPairsData&& data) {
+			all_pairs_data_ = std::move(data);
+		}
+
+		void TransportRouter::BuildRouter() {
+			// Stored data belonging to another graph is rejected with std::invalid_argument: the router is then prepared from scratch
+			if (router_mode_ == graph::RouterMode::CONTRACTION_HIERARCHY && hierarchy_data_) {
+				graph::ContractionHierarchy<double>::Data data = std::move(*hierarchy_data_);
+				hierarchy_data_.reset();
+				try {
+					router_ = std::make_unique<graph::Router<double>>(graph_, graph::ContractionHierarchy<double>(graph_, std::move(data)));
+					return;
+				}
+				catch (const std::invalid_argument&) {
+				}
+			}
+			if ((router_mode_ == graph::RouterMode::ALL_PAIRS || router_mode_ == graph::RouterMode::BLOCKED_ALL_PAIRS) && all_pairs_data_) {
+				graph::Router<double>::AllPairsData data = std::move(*all_pairs_data_);
+				all_pairs_data_.reset();
+				try {
+					router_ = std::make_unique<graph::Router<double>>(graph_, router_mode_, std::move(data));
+					return;
+				}
+				catch (const std::invalid_argument&) {
+				}
+			}
+			router_ = std::make_unique<graph::Router<double>>(graph_, router_mode_);
+		}
+
+		const graph::Router<double>* TransportRouter::GetRouter() const {
+			return router_.get();
+		}
+
 		const graph::DirectedWeightedGraph<double>& TransportRouter::GetGraph() const {
 			return graph_;
 		}
 
-		json::Node TransportRouter::GetRouteNode(const graph::Router<double>& router, const std::string& from, const std::string& to, int id) const {
+		const std::vector<TGraphEdge>& TransportRouter::GetEdges() const {
+			return edges_;
+		}
+
+		const TransportRouter::StopVertexes& TransportRouter::GetStopVertexes() const {
+			return vertexes_;
+		}
+
+		void TransportRouter::RestoreGraph(graph::DirectedWeightedGraph<double>&& graph, std::vector<TGraphEdge>&& edges, StopVertexes&& vertexes) {
+			if (edges.size() != graph.GetEdgeCount()) {
+				throw std::invalid_argument("Edges don't match the graph");
+			}
+			router_.reset();
+			graph_ = std::move(graph);
+			edges_ = std::move(edges);
+			vertexes_ = std::move(vertexes);
+		}
+
+		bool TransportRouter::HasGraph() const {
+			return graph_.IsFrozen();
+		}
+
+		json::Node TransportRouter::GetRouteNode(const std::string& from, const std::string& to, int id) const {
 			using namespace std::literals;
 			using namespace json_reader;
 			if (from == to) {
@@ -61,18 +183,43 @@ namespace TransportCatalogue {
 			if (vertexes_.count(from) < 1 || vertexes_.count(to) < 1) {
 				return MakeNodeForError(id);
 			}
-			auto route_info = router.BuildRoute(vertexes_.at(from), vertexes_.at(to));
+			auto route_info = router_->BuildRoute(vertexes_.at(from), vertexes_.at(to));
 			if (!route_info.has_value()) {
 				return MakeNodeForError(id);
 			}
 			size_t size = (route_info->edges).size();
 			json::Array array;
 			array.reserve(size * 2u);
+			// A BOARD edge opens a bus trip, RIDE edges extend it and an ALIGHT edge closes it
+			double ride_time = 0.0;
+			int ride_span_count = 0;
 			for (graph::EdgeId id : route_info->edges) {
-				ItemWait wait("Wait"s, settings_.bus_wait_time_, std::string(edges_[id].from));
-				array.push_back(json_reader::MakeDictFromItem(&wait));
-				ItemBus bus("Bus"s, edges_[id].weight - settings_.bus_wait_time_, std::string(edges_[id].name), edges_[id].span_count_);
-				array.push_back(json_reader::MakeDictFromItem(&bus));
+				const TGraphEdge& edge = edges_[id];
+				switch (edge.kind) {
+				case EdgeKind::SPAN: {
+					ItemWait wait("Wait"s, settings_.bus_wait_time_, std::string(edge.from));
+					array.push_back(json_reader::MakeDictFromItem(&wait));
+					ItemBus bus("Bus"s, edge.weight - settings_.bus_wait_time_, std::string(edge.name), edge.span_count_);
+					array.push_back(json_reader::MakeDictFromItem(&bus));
+					break;
+				}
+				case EdgeKind::BOARD: {
+					ItemWait wait("Wait"s, edge.weight, std::string(edge.from));
+					array.push_back(json_reader::MakeDictFromItem(&wait));
+					ride_time = 0.0;
+					ride_span_count = 0;
+					break;
+				}
+				case EdgeKind::RIDE:
+					ride_time += edge.weight;
+					ride_span_count += static_cast<int>(edge.span_count_);
+					break;
+				case EdgeKind::ALIGHT: {
+					ItemBus bus("Bus"s, ride_time, std::string(edge.name), ride_span_count);
+					array.push_back(json_reader::MakeDictFromItem(&bus));
+					break;
+				}
+				}
 			}
 			return json_reader::MakeNodeForRoute(id, route_info->weight, std::move(array));
 		}
@@ -84,6 +231,11 @@ namespace TransportCatalogue {
 			}
 		}
 
+		void TransportRouter::AddTransferEdge(TGraphEdge&& graph_edge, graph::VertexId from, graph::VertexId to) {
+			graph_edge.id = graph_.AddEdge({ from, to, graph_edge.weight });
+			edges_.push_back(std::move(graph_edge));
+		}
+
 		void TransportRouter::AddRouteEdge(TGraphEdge&& graph_edge, std::string_view to) {
 			graph_edge.weight = (graph_edge.weight / settings_.bus_velocity_m_m_) + settings_.bus_wait_time_;
 			graph_edge.id = graph_.AddEdge({ vertexes_.at(graph_edge.from), vertexes_.at(to), graph_edge.weight });
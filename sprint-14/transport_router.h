@@ -9,42 +9,75 @@
 #include <string>
 #include <string_view>
 #include <set>
+#include <memory>
+#include <optional>
 
 namespace TransportCatalogue {
 
 	namespace transport_router {
 
+		enum class EdgeKind {
+			SPAN,   // wait and ride span_count_ stops (GraphModel::STOP_PAIRS)
+			BOARD,  // wait at the stop `from` for the bus `name`
+			RIDE,   // ride to the next stop of the route
+			ALIGHT, // leave the bus
+		};
+
 		struct TGraphEdge {
 			graph::EdgeId id;
 			std::string_view from;
 			std::string_view name;
 			size_t span_count_;
 			double weight;
-
+			EdgeKind kind = EdgeKind::SPAN;
 		};
 
 		class TransportRouter {
 		public:
 			using BusesAndStops = std::pair<std::set<const Bus*, detail::BusHasher>, std::map<std::string_view, const Stop*>>;
+			using StopVertexes = std::unordered_map<std::string_view, graph::VertexId>;
 
 			TransportRouter(const TransportCatalogue& catalogue);
 			void SetSettings(BusTimesSettings&& settings);
 			BusTimesSettings GetSettings() const;
+			void SetRouterMode(graph::RouterMode mode);
+			graph::RouterMode GetRouterMode() const;
+			// Hierarchy read from a serialized base; BuildRouter() uses it instead of contracting the graph again
+			void SetContractionHierarchyData(graph::ContractionHierarchy<double>::Data&& data);
+			// Routes of the ALL_PAIRS modes read from a serialized base; BuildRouter() uses them instead of computing them again
+			void SetAllPairsData(graph::Router<double>::AllPairsData&& data);
 			void FillGraph();
+			// Takes a graph read from a serialized base instead of FillGraph(); names in edges and vertexes point into the catalogue
+			void RestoreGraph(graph::DirectedWeightedGraph<double>&& graph, std::vector<TGraphEdge>&& edges, StopVertexes&& vertexes);
+			bool HasGraph() const;
+			// Prepares the router over the filled graph in the chosen mode
+			void BuildRouter();
+			const graph::Router<double>* GetRouter() const;
 
 			const graph::DirectedWeightedGraph<double>& GetGraph() const;
-			json::Node GetRouteNode(const graph::Router<double>& router, const std::string& from, const std::string& to, int id) const;
+			const std::vector<TGraphEdge>& GetEdges() const;
+			const StopVertexes& GetStopVertexes() const;
+			json::Node GetRouteNode(const std::string& from, const std::string& to, int id) const;
 
 		private:
 			graph::DirectedWeightedGraph<double> graph_;
 			const TransportCatalogue& catalogue_;
 
 			BusTimesSettings settings_;
+			graph::RouterMode router_mode_ = graph::RouterMode::DIJKSTRA;
+			std::unique_ptr<graph::Router<double>> router_;
+			std::optional<graph::ContractionHierarchy<double>::Data> hierarchy_data_;
+			std::optional<graph::Router<double>::AllPairsData> all_pairs_data_;
 			std::vector<TGraphEdge> edges_;
-			std::unordered_map<std::string_view, graph::VertexId> vertexes_;
+			StopVertexes vertexes_;
 
 			void FillStopsVertexes(const std::map<std::string_view, const Stop*>& stops);
+			void FillStopPairsGraph(const std::set<const Bus*, detail::BusHasher>& buses, size_t stop_count);
+			void FillTransferGraph(const std::set<const Bus*, detail::BusHasher>& buses, size_t stop_count);
+			// Adds the ride vertices of one direction of the route, starting at first_vertex
+			void AddRideChain(const Bus* route, bool reversed, graph::VertexId first_vertex);
 			void AddRouteEdge(TGraphEdge&& graph_edge, std::string_view to);
+			void AddTransferEdge(TGraphEdge&& graph_edge, graph::VertexId from, graph::VertexId to);
 
 		};
 
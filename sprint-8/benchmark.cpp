@@ -0,0 +1,318 @@
+#include "process_queries.h"
+#include "search_server.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <execution>
+#include <iostream>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef __linux__
+#include <fstream>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+struct BenchmarkSettings {
+    int document_count = 10000;
+    int words_per_document = 50;
+    int vocabulary_size = 20000;
+    double zipf_exponent = 1.0;
+    int stop_word_count = 20;
+    double stop_word_ratio = 0.2;  // доля стоп-слов среди слов документа
+    int query_count = 500;
+    unsigned seed = 42;
+};
+
+struct Corpus {
+    vector<string> vocabulary;
+    vector<string> stop_words;
+    vector<string> documents;
+};
+
+// Слово ранга r выпадает с вероятностью, пропорциональной 1 / r^s
+class ZipfGenerator {
+public:
+    ZipfGenerator(int size, double exponent) {
+        cumulative_.reserve(size);
+        double sum = 0.0;
+        for (int rank = 1; rank <= size; ++rank) {
+            sum += 1.0 / pow(rank, exponent);
+            cumulative_.push_back(sum);
+        }
+    }
+
+    template <typename Generator>
+    int operator()(Generator& generator) const {
+        uniform_real_distribution<double> distribution(0.0, cumulative_.back());
+        const auto it = lower_bound(cumulative_.begin(), cumulative_.end(), distribution(generator));
+        return static_cast<int>(min<size_t>(it - cumulative_.begin(), cumulative_.size() - 1));
+    }
+
+private:
+    vector<double> cumulative_;
+};
+
+string GenerateWord(mt19937& generator, int max_length) {
+    const int length = uniform_int_distribution(3, max_length)(generator);
+    string word(length, ' ');
+    for (char& c : word) {
+        c = static_cast<char>(uniform_int_distribution('a', 'z')(generator));
+    }
+    return word;
+}
+
+vector<string> GenerateUniqueWords(mt19937& generator, int count, int max_length) {
+    vector<string> words;
+    words.reserve(count);
+    set<string> seen;
+    while (static_cast<int>(words.size()) < count) {
+        string word = GenerateWord(generator, max_length);
+        if (seen.insert(word).second) {
+            words.push_back(move(word));
+        }
+    }
+    return words;
+}
+
+Corpus GenerateCorpus(mt19937& generator, const ZipfGenerator& zipf, const BenchmarkSettings& settings) {
+    Corpus corpus;
+    auto words = GenerateUniqueWords(generator, settings.vocabulary_size + settings.stop_word_count, 12);
+    corpus.stop_words.assign(words.begin() + settings.vocabulary_size, words.end());
+    words.resize(settings.vocabulary_size);
+    corpus.vocabulary = move(words);
+
+    bernoulli_distribution is_stop_word(settings.stop_word_ratio);
+    uniform_int_distribution<int> stop_word_index(0, settings.stop_word_count - 1);
+    corpus.documents.reserve(settings.document_count);
+    for (int i = 0; i < settings.document_count; ++i) {
+        string document;
+        for (int j = 0; j < settings.words_per_document; ++j) {
+            if (j > 0) {
+                document.push_back(' ');
+            }
+            if (settings.stop_word_count > 0 && is_stop_word(generator)) {
+                document += corpus.stop_words[stop_word_index(generator)];
+            } else {
+                document += corpus.vocabulary[zipf(generator)];
+            }
+        }
+        corpus.documents.push_back(move(document));
+    }
+    return corpus;
+}
+
+string GenerateQuery(mt19937& generator, const ZipfGenerator& zipf, const Corpus& corpus, int plus_count, int minus_count) {
+    string query;
+    for (int i = 0; i < plus_count + minus_count; ++i) {
+        if (i > 0) {
+            query.push_back(' ');
+        }
+        if (i >= plus_count) {
+            query.push_back('-');
+        }
+        query += corpus.vocabulary[zipf(generator)];
+    }
+    return query;
+}
+
+struct QueryMix {
+    string name;
+    int plus_count;
+    int minus_count;
+};
+
+struct LatencyStats {
+    double p50_us = 0.0;
+    double p99_us = 0.0;
+    double mean_us = 0.0;
+};
+
+LatencyStats ComputeLatencyStats(vector<double> latencies_us) {
+    LatencyStats stats;
+    if (latencies_us.empty()) {
+        return stats;
+    }
+    sort(latencies_us.begin(), latencies_us.end());
+    const auto percentile = [&latencies_us](double fraction) {
+        return latencies_us[min(latencies_us.size() - 1, static_cast<size_t>(fraction * latencies_us.size()))];
+    };
+    stats.p50_us = percentile(0.5);
+    stats.p99_us = percentile(0.99);
+    double sum = 0.0;
+    for (double latency : latencies_us) {
+        sum += latency;
+    }
+    stats.mean_us = sum / latencies_us.size();
+    return stats;
+}
+
+double ElapsedSeconds(Clock::time_point start) {
+    return chrono::duration<double>(Clock::now() - start).count();
+}
+
+template <typename ExecutionPolicy>
+LatencyStats MeasureQueries(const SearchServer& search_server, ExecutionPolicy policy, const vector<string>& queries) {
+    vector<double> latencies_us;
+    latencies_us.reserve(queries.size());
+    for (const string& query : queries) {
+        const auto start = Clock::now();
+        const auto documents = search_server.FindTopDocuments(policy, query, DocumentStatus::ACTUAL);
+        latencies_us.push_back(ElapsedSeconds(start) * 1e6);
+    }
+    return ComputeLatencyStats(move(latencies_us));
+}
+
+// Резидентная память процесса; 0, если платформа её не сообщает
+size_t GetResidentMemoryBytes() {
+#ifdef __linux__
+    ifstream statm("/proc/self/statm"s);
+    size_t total_pages = 0;
+    size_t resident_pages = 0;
+    if (statm >> total_pages >> resident_pages) {
+        return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    }
+#endif
+    return 0;
+}
+
+void PrintLatency(ostream& out, const LatencyStats& stats) {
+    out << "{\"p50_us\": "s << stats.p50_us << ", \"p99_us\": "s << stats.p99_us
+        << ", \"mean_us\": "s << stats.mean_us << "}"s;
+}
+
+BenchmarkSettings ParseSettings(int argc, char** argv) {
+    BenchmarkSettings settings;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const string_view key = argv[i];
+        const char* value = argv[i + 1];
+        if (key == "--documents"sv) {
+            settings.document_count = atoi(value);
+        } else if (key == "--words"sv) {
+            settings.words_per_document = atoi(value);
+        } else if (key == "--vocabulary"sv) {
+            settings.vocabulary_size = atoi(value);
+        } else if (key == "--zipf"sv) {
+            settings.zipf_exponent = atof(value);
+        } else if (key == "--stop-words"sv) {
+            settings.stop_word_count = atoi(value);
+        } else if (key == "--stop-ratio"sv) {
+            settings.stop_word_ratio = atof(value);
+        } else if (key == "--queries"sv) {
+            settings.query_count = atoi(value);
+        } else if (key == "--seed"sv) {
+            settings.seed = static_cast<unsigned>(atoi(value));
+        } else {
+            throw invalid_argument("Unknown option: "s + string(key));
+        }
+    }
+    if (settings.document_count <= 0 || settings.words_per_document <= 0 || settings.vocabulary_size <= 0
+        || settings.stop_word_count < 0 || settings.query_count <= 0) {
+        throw invalid_argument("Benchmark sizes must be positive"s);
+    }
+    // Отрицательное сравнение отсекает и NaN, который atof вернёт для "nan"
+    if (!(settings.stop_word_ratio >= 0.0 && settings.stop_word_ratio <= 1.0)) {
+        throw invalid_argument("Stop word ratio must be in [0, 1]"s);
+    }
+    return settings;
+}
+
+}  // namespace
+
+// Результаты печатаются одной JSON-строкой в stdout, чтобы их можно было сравнивать между запусками
+int main(int argc, char** argv) {
+    BenchmarkSettings settings;
+    try {
+        settings = ParseSettings(argc, argv);
+    } catch (const invalid_argument& e) {
+        cerr << e.what() << endl;
+        cerr << "Usage: "s << argv[0] << " [--documents N] [--words N] [--vocabulary N] [--zipf S]"s
+             << " [--stop-words N] [--stop-ratio R] [--queries N] [--seed N]"s << endl;
+        return 1;
+    }
+
+    mt19937 generator(settings.seed);
+    const ZipfGenerator zipf(settings.vocabulary_size, settings.zipf_exponent);
+    const Corpus corpus = GenerateCorpus(generator, zipf, settings);
+
+    string stop_words_text;
+    for (const string& word : corpus.stop_words) {
+        stop_words_text += word + ' ';
+    }
+
+    const size_t memory_before = GetResidentMemoryBytes();
+    SearchServer search_server(stop_words_text);
+    const auto ingest_start = Clock::now();
+    for (int id = 0; id < settings.document_count; ++id) {
+        search_server.AddDocument(id, corpus.documents[id], DocumentStatus::ACTUAL, {id % 10});
+    }
+    const double ingest_seconds = ElapsedSeconds(ingest_start);
+    const size_t memory_after = GetResidentMemoryBytes();
+
+    const vector<QueryMix> mixes = {
+        {"short"s, 3, 0},
+        {"long"s, 20, 0},
+        {"minus_heavy"s, 2, 8},
+    };
+
+    cout << "{\"settings\": {\"documents\": "s << settings.document_count
+         << ", \"words_per_document\": "s << settings.words_per_document
+         << ", \"vocabulary\": "s << settings.vocabulary_size
+         << ", \"zipf\": "s << settings.zipf_exponent
+         << ", \"stop_words\": "s << settings.stop_word_count
+         << ", \"stop_ratio\": "s << settings.stop_word_ratio
+         << ", \"queries\": "s << settings.query_count
+         << ", \"seed\": "s << settings.seed << "}"s;
+    cout << ", \"ingest\": {\"seconds\": "s << ingest_seconds
+         << ", \"documents_per_second\": "s << settings.document_count / ingest_seconds
+         << ", \"words_per_second\": "s
+         << static_cast<double>(settings.document_count) * settings.words_per_document / ingest_seconds
+         << ", \"memory_bytes\": "s << (memory_after > memory_before ? memory_after - memory_before : 0) << "}"s;
+
+    cout << ", \"queries\": {"s;
+    bool first_mix = true;
+    for (const QueryMix& mix : mixes) {
+        vector<string> queries;
+        queries.reserve(settings.query_count);
+        for (int i = 0; i < settings.query_count; ++i) {
+            queries.push_back(GenerateQuery(generator, zipf, corpus, mix.plus_count, mix.minus_count));
+        }
+        cerr << "Running "s << mix.name << " queries"s << endl;
+
+        if (!first_mix) {
+            cout << ", "s;
+        }
+        first_mix = false;
+        cout << '"' << mix.name << "\": {\"seq\": "s;
+        PrintLatency(cout, MeasureQueries(search_server, execution::seq, queries));
+        cout << ", \"par\": "s;
+        PrintLatency(cout, MeasureQueries(search_server, execution::par, queries));
+
+        // Пакетная обработка: последовательный цикл против параллельного ProcessQueries
+        const auto seq_start = Clock::now();
+        for (const string& query : queries) {
+            search_server.FindTopDocuments(query);
+        }
+        const double seq_seconds = ElapsedSeconds(seq_start);
+        const auto par_start = Clock::now();
+        ProcessQueries(search_server, queries);
+        const double par_seconds = ElapsedSeconds(par_start);
+        cout << ", \"batch\": {\"seq_seconds\": "s << seq_seconds << ", \"par_seconds\": "s << par_seconds
+             << ", \"speedup\": "s << seq_seconds / par_seconds << "}}"s;
+    }
+    cout << "}}"s << endl;
+
+    return 0;
+}
@@ -0,0 +1,187 @@
+#include "bulk_loader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <execution>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define BULK_LOADER_HAS_MMAP
+#endif
+
+using namespace std;
+
+namespace {
+
+const size_t CHUNK_SIZE = 4 * 1024 * 1024;
+
+int ParseInt(string_view text) {
+    int value = 0;
+    const auto [ptr, ec] = from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != errc() || ptr != text.data() + text.size()) {
+        throw invalid_argument("Invalid number: "s + string(text));
+    }
+    return value;
+}
+
+DocumentStatus ParseStatus(string_view text) {
+    if (text == "ACTUAL"sv) {
+        return DocumentStatus::ACTUAL;
+    } else if (text == "IRRELEVANT"sv) {
+        return DocumentStatus::IRRELEVANT;
+    } else if (text == "BANNED"sv) {
+        return DocumentStatus::BANNED;
+    } else if (text == "REMOVED"sv) {
+        return DocumentStatus::REMOVED;
+    }
+    throw invalid_argument("Invalid document status: "s + string(text));
+}
+
+// Отрезает от line поле до ближайшего разделителя
+string_view TakeField(string_view& line, char delimiter) {
+    const size_t pos = line.find(delimiter);
+    const string_view field = line.substr(0, pos);
+    line.remove_prefix(pos == line.npos ? line.size() : pos + 1);
+    return field;
+}
+
+DocumentRecord ParseTsvLine(string_view line) {
+    DocumentRecord record;
+    const size_t field_count = count(line.begin(), line.end(), '\t') + 1;
+    if (field_count != 4) {
+        throw invalid_argument("Expected 4 tab-separated fields: "s + string(line.substr(0, 64)));
+    }
+    record.id = ParseInt(TakeField(line, '\t'));
+    record.status = ParseStatus(TakeField(line, '\t'));
+    string_view ratings = TakeField(line, '\t');
+    while (!ratings.empty()) {
+        record.ratings.push_back(ParseInt(TakeField(ratings, ',')));
+    }
+    record.text = line;
+    return record;
+}
+
+}  // namespace
+
+#ifdef BULK_LOADER_HAS_MMAP
+
+MappedFile::MappedFile(const string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw runtime_error("Cannot open "s + path);
+    }
+    struct stat file_stat {};
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        throw runtime_error("Cannot stat "s + path);
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+    if (size_ > 0) {
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            throw runtime_error("Cannot map "s + path);
+        }
+        madvise(data, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(data);
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (data_ != nullptr) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+#else
+
+MappedFile::MappedFile(const string& path) {
+    ifstream input(path, ios::binary);
+    if (!input) {
+        throw runtime_error("Cannot open "s + path);
+    }
+    buffer_.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+}
+
+MappedFile::~MappedFile() = default;
+
+#endif
+
+string_view MappedFile::GetData() const {
+    return {data_, size_};
+}
+
+vector<string_view> SplitIntoLineChunks(string_view data, size_t chunk_size) {
+    vector<string_view> chunks;
+    while (!data.empty()) {
+        size_t end = min(max<size_t>(chunk_size, 1), data.size());
+        if (end < data.size()) {
+            const size_t line_end = data.find('\n', end - 1);
+            end = line_end == data.npos ? data.size() : line_end + 1;
+        }
+        chunks.push_back(data.substr(0, end));
+        data.remove_prefix(end);
+    }
+    return chunks;
+}
+
+vector<DocumentRecord> ParseTsvRecords(string_view chunk) {
+    vector<DocumentRecord> records;
+    while (!chunk.empty()) {
+        string_view line = TakeField(chunk, '\n');
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (!line.empty()) {
+            records.push_back(ParseTsvLine(line));
+        }
+    }
+    return records;
+}
+
+size_t LoadDocumentsFromTsv(SearchServer& search_server, const string& path) {
+    const MappedFile file(path);
+    const vector<string_view> chunks = SplitIntoLineChunks(file.GetData(), CHUNK_SIZE);
+    const size_t chunks_per_batch = max(1u, thread::hardware_concurrency()) * 2;
+
+    size_t loaded = 0;
+    for (size_t batch_begin = 0; batch_begin < chunks.size(); batch_begin += chunks_per_batch) {
+        const auto first = chunks.begin() + batch_begin;
+        const auto last = chunks.begin() + min(chunks.size(), batch_begin + chunks_per_batch);
+
+        // Исключение внутри параллельного алгоритма завершило бы программу, поэтому ошибки собираются отдельно
+        vector<string> errors(last - first);
+        vector<vector<DocumentRecord>> parsed(last - first);
+        transform(execution::par, first, last, parsed.begin(), [&](const string_view& chunk) {
+            try {
+                return ParseTsvRecords(chunk);
+            } catch (const invalid_argument& e) {
+                errors[&chunk - &*first] = e.what();
+                return vector<DocumentRecord>{};
+            }
+        });
+        for (const string& error : errors) {
+            if (!error.empty()) {
+                throw invalid_argument(path + ": "s + error);
+            }
+        }
+
+        vector<DocumentRecord> records;
+        for (auto& chunk_records : parsed) {
+            move(chunk_records.begin(), chunk_records.end(), back_inserter(records));
+        }
+        search_server.AddDocuments(execution::par, records);
+        loaded += records.size();
+    }
+    return loaded;
+}
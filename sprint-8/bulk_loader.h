@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+// Файл, отображённый в память только для чтения
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view GetData() const;
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    // Используется вместо отображения там, где нет mmap
+    std::string buffer_;
+};
+
+// Делит текст на куски примерно по chunk_size байт, не разрывая строк
+std::vector<std::string_view> SplitIntoLineChunks(std::string_view data, size_t chunk_size);
+
+// Строки вида "id \t status \t рейтинги через запятую \t текст", status — ACTUAL, IRRELEVANT, BANNED или REMOVED.
+// Тексты записей указывают прямо в chunk.
+std::vector<DocumentRecord> ParseTsvRecords(std::string_view chunk);
+
+// Загружает TSV-корпус: файл отображается в память, куски разбираются параллельно и пакетами
+// передаются в SearchServer::AddDocuments. Возвращает количество добавленных документов.
+size_t LoadDocumentsFromTsv(SearchServer& search_server, const std::string& path);
@@ -1,5 +1,7 @@
 #include "document.h"
 
+#include <charconv>
+
 using namespace std;
 
 ostream& operator<<(ostream& out, const Document& document) {
@@ -10,10 +12,81 @@ ostream& operator<<(ostream& out, const Document& document) {
     return out;
 }
 
+void DocumentWriter::AppendText(const Document& document) {
+    buffer_ += "{ document_id = "sv;
+    AppendInt(document.id);
+    buffer_ += ", relevance = "sv;
+    // Шесть значащих цифр, как у ostream по умолчанию
+    AppendDouble(document.relevance, 6);
+    buffer_ += ", rating = "sv;
+    AppendInt(document.rating);
+    buffer_ += " }\n"sv;
+}
+
+void DocumentWriter::AppendText(const vector<Document>& documents) {
+    for (const Document& document : documents) {
+        AppendText(document);
+    }
+}
+
+void DocumentWriter::AppendJson(const vector<Document>& documents) {
+    buffer_ += '[';
+    bool is_first = true;
+    for (const Document& document : documents) {
+        if (!is_first) {
+            buffer_ += ", "sv;
+        }
+        is_first = false;
+        buffer_ += "{\"document_id\": "sv;
+        AppendInt(document.id);
+        buffer_ += ", \"relevance\": "sv;
+        AppendDouble(document.relevance, 0);
+        buffer_ += ", \"rating\": "sv;
+        AppendInt(document.rating);
+        buffer_ += '}';
+    }
+    buffer_ += ']';
+}
+
+string_view DocumentWriter::GetData() const {
+    return buffer_;
+}
+
+void DocumentWriter::Clear() {
+    buffer_.clear();
+}
+
+void DocumentWriter::Flush(ostream& out) {
+    out.write(buffer_.data(), static_cast<streamsize>(buffer_.size()));
+    buffer_.clear();
+}
+
+void DocumentWriter::AppendInt(int value) {
+    char chars[16];
+    const auto result = to_chars(begin(chars), end(chars), value);
+    buffer_.append(chars, result.ptr);
+}
+
+// precision == 0 — кратчайшая запись, которая читается обратно без потерь
+void DocumentWriter::AppendDouble(double value, int precision) {
+    char chars[32];
+    const auto result = precision > 0
+            ? to_chars(begin(chars), end(chars), value, chars_format::general, precision)
+            : to_chars(begin(chars), end(chars), value);
+    buffer_.append(chars, result.ptr);
+}
+
 void PrintDocument(const Document& document) {
     cout << document << endl;
 }
 
+void PrintDocuments(const vector<Document>& documents) {
+    DocumentWriter writer;
+    writer.AppendText(documents);
+    writer.Flush(cout);
+    cout.flush();
+}
+
 void PrintMatchDocumentResult(int document_id, const vector<string>& words, DocumentStatus status) {
     cout << "{ "s
          << "document_id = "s << document_id << ", "s
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
 #include <vector>
 #include <string>
+#include <string_view>
 
 enum class DocumentStatus {
     ACTUAL,
@@ -25,7 +27,53 @@ struct Document {
     int rating = 0;
 };
 
+// Компактная запись для внутренних буферов выдачи: 16 байт вместо 24 у Document за счёт порядка полей.
+// Релевантность и рейтинг хранятся без потери точности и возвращаются в Document как есть.
+struct PackedDocument {
+    PackedDocument() = default;
+
+    PackedDocument(int id, double relevance, int rating)
+            : relevance(relevance)
+            , id(id)
+            , rating(rating) {
+    }
+
+    double relevance = 0.0;
+    int32_t id = 0;
+    int32_t rating = 0;
+};
+
+// Документ для пакетной загрузки; text должен жить до конца вызова SearchServer::AddDocuments
+struct DocumentRecord {
+    int id = 0;
+    std::string_view text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
+
 std::ostream& operator<<(std::ostream& out, const Document& document);
 
+// Форматирует документы в переиспользуемый буфер через std::to_chars, без iostream на каждое поле
+class DocumentWriter {
+public:
+    // Тот же формат, что у operator<<, с переводом строки после каждого документа
+    void AppendText(const Document& document);
+    void AppendText(const std::vector<Document>& documents);
+    // Массив объектов {"document_id": ..., "relevance": ..., "rating": ...}
+    void AppendJson(const std::vector<Document>& documents);
+
+    std::string_view GetData() const;
+    void Clear();
+    // Выводит накопленное одним вызовом write и очищает буфер
+    void Flush(std::ostream& out);
+
+private:
+    void AppendInt(int value);
+    void AppendDouble(double value, int precision);
+
+    std::string buffer_;
+};
+
 void PrintDocument(const Document& document);
+void PrintDocuments(const std::vector<Document>& documents);
 void PrintMatchDocumentResult(int document_id, const std::vector<std::string>& words, DocumentStatus status);
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <algorithm>
 #include <iostream>
+#include <iterator>
 #include <vector>
 
 template <typename Iterator>
@@ -12,6 +14,12 @@ public:
             , size_(distance(first_, last_)) {
     }
 
+    IteratorRange(Iterator begin, Iterator end, size_t size)
+            : first_(begin)
+            , last_(end)
+            , size_(size) {
+    }
+
     Iterator begin() const {
         return first_;
     }
@@ -37,37 +45,94 @@ std::ostream& operator<<(std::ostream& out, const IteratorRange<Iterator>& range
     return out;
 }
 
+// Страницы не хранятся: границы очередной страницы вычисляются при обращении к ней.
+// Для итераторов произвольного доступа любая страница достаётся за O(1).
 template <typename Iterator>
 class Paginator {
 public:
-    Paginator(Iterator begin, Iterator end, size_t page_size) {
-        for (size_t left = distance(begin, end); left > 0;) {
-            const size_t current_page_size = std::min(page_size, left);
-            const Iterator current_page_end = next(begin, current_page_size);
-            pages_.push_back({begin, current_page_end});
-
-            left -= current_page_size;
-            begin = current_page_end;
+    class PageIterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = IteratorRange<Iterator>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = IteratorRange<Iterator>;
+
+        PageIterator(Iterator first, size_t left, size_t page_size)
+                : first_(first)
+                , left_(left)
+                , page_size_(page_size) {
+        }
+
+        IteratorRange<Iterator> operator*() const {
+            const size_t current_page_size = std::min(page_size_, left_);
+            return {first_, std::next(first_, current_page_size), current_page_size};
+        }
+
+        PageIterator& operator++() {
+            const size_t current_page_size = std::min(page_size_, left_);
+            std::advance(first_, current_page_size);
+            left_ -= current_page_size;
+            return *this;
+        }
+
+        PageIterator operator++(int) {
+            PageIterator prev = *this;
+            ++*this;
+            return prev;
+        }
+
+        bool operator==(const PageIterator& other) const {
+            return left_ == other.left_;
+        }
+
+        bool operator!=(const PageIterator& other) const {
+            return !(*this == other);
         }
+
+    private:
+        Iterator first_;
+        size_t left_;
+        size_t page_size_;
+    };
+
+    Paginator(Iterator begin, Iterator end, size_t page_size)
+            : first_(begin)
+            , last_(end)
+            , items_count_(distance(begin, end))
+            , page_size_(page_size) {
     }
 
-    auto begin() const {
-        return pages_.begin();
+    PageIterator begin() const {
+        return {first_, page_size_ == 0 ? 0 : items_count_, page_size_};
     }
 
-    auto end() const {
-        return pages_.end();
+    PageIterator end() const {
+        return {last_, 0, page_size_};
     }
 
     size_t size() const {
-        return pages_.size();
+        return page_size_ == 0 ? 0 : (items_count_ + page_size_ - 1) / page_size_;
+    }
+
+    // Страницы за последней пусты. Номер сравнивается до умножения, чтобы page * page_size_ не переполнилось
+    IteratorRange<Iterator> operator[](size_t page) const {
+        if (page >= size()) {
+            return {last_, last_, 0};
+        }
+        const size_t offset = page * page_size_;
+        const size_t current_page_size = std::min(page_size_, items_count_ - offset);
+        const Iterator page_begin = std::next(first_, offset);
+        return {page_begin, std::next(page_begin, current_page_size), current_page_size};
     }
 
 private:
-    std::vector<IteratorRange<Iterator>> pages_;
+    Iterator first_, last_;
+    size_t items_count_;
+    size_t page_size_;
 };
 
 template <typename Container>
 auto Paginate(const Container& c, size_t page_size) {
     return Paginator(begin(c), end(c), page_size);
-}
\ No newline at end of file
+}
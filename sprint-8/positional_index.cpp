@@ -0,0 +1,117 @@
+#include "positional_index.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+using namespace std;
+
+void PositionalIndex::AddDocument(int document_id, const vector<TermId>& terms) {
+    map<TermId, vector<uint32_t>> term_to_positions;
+    for (uint32_t position = 0; position < terms.size(); ++position) {
+        term_to_positions[terms[position]].push_back(position);
+    }
+
+    for (const auto& [term_id, positions] : term_to_positions) {
+        if (term_id >= word_to_document_positions_.size()) {
+            word_to_document_positions_.resize(term_id + 1);
+        }
+        word_to_document_positions_[term_id][document_id] = Encode(positions);
+    }
+}
+
+void PositionalIndex::RemoveDocument(int document_id, const vector<TermId>& terms) {
+    for (const TermId term_id : terms) {
+        if (term_id < word_to_document_positions_.size()) {
+            word_to_document_positions_[term_id].erase(document_id);
+        }
+    }
+}
+
+vector<uint32_t> PositionalIndex::GetPositions(TermId term_id, int document_id) const {
+    if (term_id >= word_to_document_positions_.size()) {
+        return {};
+    }
+    const auto& documents = word_to_document_positions_[term_id];
+    const auto it = documents.find(document_id);
+    return it == documents.end() ? vector<uint32_t>{} : Decode(it->second);
+}
+
+bool PositionalIndex::ContainsPhrase(int document_id, const vector<TermId>& phrase) const {
+    if (phrase.empty()) {
+        return true;
+    }
+
+    vector<vector<uint32_t>> positions;
+    positions.reserve(phrase.size());
+    for (const TermId term_id : phrase) {
+        positions.push_back(GetPositions(term_id, document_id));
+        if (positions.back().empty()) {
+            return false;
+        }
+    }
+
+    return any_of(positions[0].begin(), positions[0].end(), [&positions](uint32_t start) {
+        for (size_t i = 1; i < positions.size(); ++i) {
+            if (!binary_search(positions[i].begin(), positions[i].end(), start + static_cast<uint32_t>(i))) {
+                return false;
+            }
+        }
+        return true;
+    });
+}
+
+uint32_t PositionalIndex::ComputeMinimalDistance(int document_id, const vector<TermId>& terms) const {
+    // Пары (позиция, номер слова в terms), упорядоченные по позиции
+    vector<pair<uint32_t, size_t>> occurrences;
+    for (size_t i = 0; i < terms.size(); ++i) {
+        for (const uint32_t position : GetPositions(terms[i], document_id)) {
+            occurrences.emplace_back(position, i);
+        }
+    }
+    sort(occurrences.begin(), occurrences.end());
+
+    uint32_t distance = numeric_limits<uint32_t>::max();
+    for (size_t i = 1; i < occurrences.size(); ++i) {
+        if (occurrences[i].second != occurrences[i - 1].second) {
+            distance = min(distance, occurrences[i].first - occurrences[i - 1].first);
+        }
+    }
+    return distance == numeric_limits<uint32_t>::max() ? 0 : distance;
+}
+
+vector<uint8_t> PositionalIndex::Encode(const vector<uint32_t>& positions) {
+    vector<uint8_t> encoded;
+    encoded.reserve(positions.size());
+    uint32_t previous = 0;
+    for (const uint32_t position : positions) {
+        uint32_t delta = position - previous;
+        previous = position;
+        while (delta >= 0x80) {
+            encoded.push_back(static_cast<uint8_t>(delta | 0x80));
+            delta >>= 7;
+        }
+        encoded.push_back(static_cast<uint8_t>(delta));
+    }
+    encoded.shrink_to_fit();
+    return encoded;
+}
+
+vector<uint32_t> PositionalIndex::Decode(const vector<uint8_t>& encoded) {
+    vector<uint32_t> positions;
+    uint32_t previous = 0;
+    uint32_t delta = 0;
+    int shift = 0;
+    for (const uint8_t byte : encoded) {
+        delta |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (byte & 0x80) {
+            shift += 7;
+            continue;
+        }
+        previous += delta;
+        positions.push_back(previous);
+        delta = 0;
+        shift = 0;
+    }
+    return positions;
+}
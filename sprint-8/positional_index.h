@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "term_dictionary.h"
+
+// Позиции слов в документах (номера среди слов документа без стоп-слов).
+// Лежат отдельно от частот слов, поэтому запросы, которым позиции не нужны, их не читают.
+// Позиции слова в документе хранятся разностями соседних значений в формате varint.
+class PositionalIndex {
+public:
+    using TermId = TermDictionary::TermId;
+
+    // terms — слова документа в порядке следования
+    void AddDocument(int document_id, const std::vector<TermId>& terms);
+    void RemoveDocument(int document_id, const std::vector<TermId>& terms);
+
+    std::vector<uint32_t> GetPositions(TermId term_id, int document_id) const;
+
+    // Слова phrase идут в документе подряд
+    bool ContainsPhrase(int document_id, const std::vector<TermId>& phrase) const;
+
+    // Наименьшее расстояние между вхождениями двух разных слов из terms; 0, если таких пар нет
+    uint32_t ComputeMinimalDistance(int document_id, const std::vector<TermId>& terms) const;
+
+private:
+    static std::vector<uint8_t> Encode(const std::vector<uint32_t>& positions);
+    static std::vector<uint32_t> Decode(const std::vector<uint8_t>& encoded);
+
+    // Индекс — TermId
+    std::vector<std::map<int, std::vector<uint8_t>>> word_to_document_positions_;
+};
@@ -0,0 +1,255 @@
+#include "profile.h"
+
+#include <algorithm>
+#include <memory>
+
+using namespace std;
+
+namespace profile {
+
+namespace {
+
+struct Registry {
+    mutex threads_mutex;
+    // Профили потоков живут до конца программы, чтобы отчёт видел и завершившиеся потоки
+    vector<unique_ptr<detail::ThreadProfile>> threads;
+};
+
+Registry& GetRegistry() {
+    static Registry registry;
+    return registry;
+}
+
+size_t HistogramBucket(uint64_t ns) {
+    size_t bucket = 0;
+    while (ns != 0 && bucket + 1 < HISTOGRAM_SIZE) {
+        ns >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+void StoreMax(atomic<uint64_t>& value, uint64_t candidate) {
+    if (candidate > value.load(memory_order_relaxed)) {
+        value.store(candidate, memory_order_relaxed);
+    }
+}
+
+void StoreMin(atomic<uint64_t>& value, uint64_t candidate) {
+    if (candidate < value.load(memory_order_relaxed)) {
+        value.store(candidate, memory_order_relaxed);
+    }
+}
+
+void Increase(atomic<uint64_t>& value, uint64_t delta) {
+    value.store(value.load(memory_order_relaxed) + delta, memory_order_relaxed);
+}
+
+void MergeInto(ReportNode& report, const detail::ThreadProfile& profile, size_t node_index) {
+    const detail::Node& node = profile.nodes[node_index];
+    report.stats.Merge(node.Load());
+
+    for (size_t child_index : node.children) {
+        const char* name = profile.nodes[child_index].site->name;
+        auto it = find_if(report.children.begin(), report.children.end(), [name](const ReportNode& child) {
+            return child.name == name;
+        });
+        if (it == report.children.end()) {
+            report.children.push_back({name, {}, {}});
+            it = prev(report.children.end());
+        }
+        MergeInto(*it, profile, child_index);
+    }
+}
+
+void PrintNode(ostream& out, const ReportNode& node, int depth) {
+    const Stats& stats = node.stats;
+    out << string(depth * 2, ' ') << node.name << ": count = "s << stats.count
+        << ", total = "s << stats.total_ns / 1000 << " us"s;
+    if (stats.count > 0) {
+        out << ", avg = "s << stats.total_ns / stats.count << " ns"s
+            << ", min = "s << stats.min_ns << " ns"s
+            << ", max = "s << stats.max_ns << " ns"s
+            << ", p50 <= "s << stats.PercentileUpperBound(0.5) << " ns"s
+            << ", p99 <= "s << stats.PercentileUpperBound(0.99) << " ns"s;
+    }
+    out << '\n';
+    for (const ReportNode& child : node.children) {
+        PrintNode(out, child, depth + 1);
+    }
+}
+
+void PrintJsonString(ostream& out, const string& str) {
+    out << '"';
+    for (const char c : str) {
+        if (c == '"' || c == '\\') {
+            out << '\\';
+        }
+        out << c;
+    }
+    out << '"';
+}
+
+void PrintNodeJson(ostream& out, const ReportNode& node) {
+    const Stats& stats = node.stats;
+    out << "{\"name\": "s;
+    PrintJsonString(out, node.name);
+    out << ", \"count\": "s << stats.count
+        << ", \"total_ns\": "s << stats.total_ns
+        << ", \"min_ns\": "s << (stats.count > 0 ? stats.min_ns : 0)
+        << ", \"max_ns\": "s << stats.max_ns
+        << ", \"histogram\": ["s;
+    const auto last = find_if(stats.histogram.rbegin(), stats.histogram.rend(), [](uint64_t v) {
+        return v != 0;
+    }).base();
+    for (auto it = stats.histogram.begin(); it != last; ++it) {
+        if (it != stats.histogram.begin()) {
+            out << ", "s;
+        }
+        out << *it;
+    }
+    out << "], \"children\": ["s;
+    for (size_t i = 0; i < node.children.size(); ++i) {
+        if (i > 0) {
+            out << ", "s;
+        }
+        PrintNodeJson(out, node.children[i]);
+    }
+    out << "]}"s;
+}
+
+}  // namespace
+
+void Stats::Merge(const Stats& other) {
+    count += other.count;
+    total_ns += other.total_ns;
+    min_ns = std::min(min_ns, other.min_ns);
+    max_ns = std::max(max_ns, other.max_ns);
+    for (size_t i = 0; i < HISTOGRAM_SIZE; ++i) {
+        histogram[i] += other.histogram[i];
+    }
+}
+
+uint64_t Stats::PercentileUpperBound(double fraction) const {
+    const auto threshold = static_cast<uint64_t>(fraction * count);
+    uint64_t accumulated = 0;
+    for (size_t i = 0; i < HISTOGRAM_SIZE; ++i) {
+        accumulated += histogram[i];
+        if (accumulated > threshold || accumulated == count) {
+            return std::min(uint64_t{1} << i, max_ns);
+        }
+    }
+    return max_ns;
+}
+
+namespace detail {
+
+void Node::Record(uint64_t ns) {
+    Increase(count, 1);
+    Increase(total_ns, ns);
+    StoreMin(min_ns, ns);
+    StoreMax(max_ns, ns);
+    Increase(histogram[HistogramBucket(ns)], 1);
+}
+
+Stats Node::Load() const {
+    Stats stats;
+    stats.count = count.load(memory_order_relaxed);
+    stats.total_ns = total_ns.load(memory_order_relaxed);
+    stats.min_ns = min_ns.load(memory_order_relaxed);
+    stats.max_ns = max_ns.load(memory_order_relaxed);
+    for (size_t i = 0; i < HISTOGRAM_SIZE; ++i) {
+        stats.histogram[i] = histogram[i].load(memory_order_relaxed);
+    }
+    return stats;
+}
+
+void Node::Clear() {
+    count.store(0, memory_order_relaxed);
+    total_ns.store(0, memory_order_relaxed);
+    min_ns.store(UINT64_MAX, memory_order_relaxed);
+    max_ns.store(0, memory_order_relaxed);
+    for (auto& bucket : histogram) {
+        bucket.store(0, memory_order_relaxed);
+    }
+}
+
+ThreadProfile::ThreadProfile() {
+    nodes.emplace_back(nullptr, 0);
+}
+
+size_t ThreadProfile::Enter(const Site& site) {
+    for (size_t child : nodes[current].children) {
+        if (nodes[child].site == &site) {
+            current = child;
+            return child;
+        }
+    }
+
+    lock_guard guard(structure_mutex);
+    const size_t child = nodes.size();
+    nodes.emplace_back(&site, current);
+    nodes[current].children.push_back(child);
+    current = child;
+    return child;
+}
+
+void ThreadProfile::Leave(size_t node, uint64_t ns) {
+    nodes[node].Record(ns);
+    current = nodes[node].parent;
+}
+
+ThreadProfile& GetThreadProfile() {
+    thread_local ThreadProfile* profile = [] {
+        Registry& registry = GetRegistry();
+        lock_guard guard(registry.threads_mutex);
+        registry.threads.push_back(make_unique<ThreadProfile>());
+        return registry.threads.back().get();
+    }();
+    return *profile;
+}
+
+}  // namespace detail
+
+ReportNode CollectReport() {
+    ReportNode root{"root"s, {}, {}};
+    Registry& registry = GetRegistry();
+    lock_guard guard(registry.threads_mutex);
+    for (const auto& profile : registry.threads) {
+        lock_guard structure_guard(profile->structure_mutex);
+        MergeInto(root, *profile, 0);
+    }
+    return root;
+}
+
+void PrintReport(ostream& out) {
+    const ReportNode root = CollectReport();
+    for (const ReportNode& child : root.children) {
+        PrintNode(out, child, 0);
+    }
+}
+
+void PrintReportJson(ostream& out) {
+    const ReportNode root = CollectReport();
+    out << '[';
+    for (size_t i = 0; i < root.children.size(); ++i) {
+        if (i > 0) {
+            out << ", "s;
+        }
+        PrintNodeJson(out, root.children[i]);
+    }
+    out << "]\n"s;
+}
+
+void ResetReport() {
+    Registry& registry = GetRegistry();
+    lock_guard guard(registry.threads_mutex);
+    for (const auto& profile : registry.threads) {
+        lock_guard structure_guard(profile->structure_mutex);
+        for (auto& node : profile->nodes) {
+            node.Clear();
+        }
+    }
+}
+
+}  // namespace profile
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define PROFILE_SCOPE_CONCAT_INTERNAL(X, Y) X##Y
+#define PROFILE_SCOPE_CONCAT(X, Y) PROFILE_SCOPE_CONCAT_INTERNAL(X, Y)
+
+// В отличие от LOG_DURATION, PROFILE_SCOPE ничего не печатает при выходе из блока:
+// замеры копятся в потоке вызывающего и выводятся по запросу через profile::PrintReport.
+// Сборка с -DPROFILE_DISABLED полностью убирает замеры.
+#ifdef PROFILE_DISABLED
+#define PROFILE_SCOPE(name)
+#else
+#define PROFILE_SCOPE(name)                                                                \
+    static const profile::Site PROFILE_SCOPE_CONCAT(profileSite, __LINE__)(name);         \
+    profile::ScopedTimer PROFILE_SCOPE_CONCAT(profileTimer, __LINE__)(PROFILE_SCOPE_CONCAT(profileSite, __LINE__))
+#endif
+
+namespace profile {
+
+using Clock = std::chrono::steady_clock;
+
+// Бакет i гистограммы содержит замеры длительностью [2^(i-1), 2^i) нс
+const size_t HISTOGRAM_SIZE = 64;
+
+struct Site {
+    explicit Site(const char* name) : name(name) {
+    }
+
+    const char* name;
+};
+
+struct Stats {
+    uint64_t count = 0;
+    uint64_t total_ns = 0;
+    uint64_t min_ns = UINT64_MAX;
+    uint64_t max_ns = 0;
+    std::array<uint64_t, HISTOGRAM_SIZE> histogram{};
+
+    void Merge(const Stats& other);
+    // Верхняя граница бакета, в который попадает заданная доля замеров
+    uint64_t PercentileUpperBound(double fraction) const;
+};
+
+// Дерево замеров, объединённое по всем потокам; узлы с одинаковым путём имён склеиваются
+struct ReportNode {
+    std::string name;
+    Stats stats;
+    std::vector<ReportNode> children;
+};
+
+namespace detail {
+
+struct Node {
+    Node(const Site* site, size_t parent) : site(site), parent(parent) {
+    }
+
+    // Вызывается только потоком-владельцем, поэтому обходится без RMW-операций; отсюда ограничение ResetReport
+    void Record(uint64_t ns);
+    Stats Load() const;
+    void Clear();
+
+    const Site* site;
+    size_t parent;
+    std::vector<size_t> children;
+
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> total_ns{0};
+    std::atomic<uint64_t> min_ns{UINT64_MAX};
+    std::atomic<uint64_t> max_ns{0};
+    std::array<std::atomic<uint64_t>, HISTOGRAM_SIZE> histogram{};
+};
+
+// Замеры одного потока. Структуру дерева меняет только владелец и только под mutex,
+// поэтому сам владелец читает её без блокировки, а отчёт читает под mutex.
+struct ThreadProfile {
+    ThreadProfile();
+
+    size_t Enter(const Site& site);
+    void Leave(size_t node, uint64_t ns);
+
+    std::mutex structure_mutex;
+    std::deque<Node> nodes;
+    size_t current = 0;
+};
+
+ThreadProfile& GetThreadProfile();
+
+}  // namespace detail
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(const Site& site)
+            : profile_(detail::GetThreadProfile())
+            , node_(profile_.Enter(site)) {
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    ~ScopedTimer() {
+        const auto dur = Clock::now() - start_time_;
+        profile_.Leave(node_, std::chrono::duration_cast<std::chrono::nanoseconds>(dur).count());
+    }
+
+private:
+    detail::ThreadProfile& profile_;
+    const size_t node_;
+    const Clock::time_point start_time_ = Clock::now();
+};
+
+ReportNode CollectReport();
+void PrintReport(std::ostream& out = std::cerr);
+void PrintReportJson(std::ostream& out);
+// Обнуляет статистику всех потоков. Вызывать, только когда профилируемый код нигде не выполняется:
+// счётчики обновляются без RMW-операций, и замер, завершившийся во время сброса, может вернуть
+// часть старых значений. Отчёт же можно собирать в любой момент, он лишь чуть отстанет
+void ResetReport();
+
+}  // namespace profile
@@ -2,27 +2,43 @@
 
 #include "search_server.h"
 
-SearchServer::SearchServer(const std::string& stop_words_text)
-        : SearchServer(SplitIntoWords(stop_words_text)) {
+SearchServer::SearchServer(const std::string& stop_words_text, PositionalIndexMode positional_index_mode)
+        : SearchServer(SplitIntoWords(stop_words_text), positional_index_mode) {
 }
 
-SearchServer::SearchServer(std::string_view stop_words_text)
-        : SearchServer(SplitIntoWords(stop_words_text)) {
+SearchServer::SearchServer(std::string_view stop_words_text, PositionalIndexMode positional_index_mode)
+        : SearchServer(SplitIntoWords(stop_words_text), positional_index_mode) {
 }
 
 void SearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    PROFILE_SCOPE("AddDocument");
     if ((document_id < 0) || (documents_.count(document_id) > 0)) {
         throw std::invalid_argument("Invalid document_id");
     }
-    const auto words = SplitIntoWordsNoStop(document);
+    IndexDocument(document_id, SplitIntoWordsNoStop(document), status, ratings);
+}
 
+void SearchServer::IndexDocument(int document_id, const std::vector<std::string_view>& words, DocumentStatus status,
+                                 const std::vector<int>& ratings) {
     const double inv_word_count = 1.0 / words.size();
-    for (const std::string& word : words) {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
-        document_to_word_freqs_[document_id][word] += inv_word_count;
+    auto& word_freqs = document_to_word_freqs_[document_id];
+    std::vector<TermDictionary::TermId> term_ids;
+    term_ids.reserve(words.size());
+    for (std::string_view word : words) {
+        const TermDictionary::TermId term_id = dictionary_.Insert(word);
+        term_ids.push_back(term_id);
+        if (term_id == word_to_document_freqs_.size()) {
+            word_to_document_freqs_.emplace_back();
+        }
+        word_to_document_freqs_[term_id][document_id] += inv_word_count;
+        word_freqs[dictionary_.GetTerm(term_id)] += inv_word_count;
+    }
+    if (positions_) {
+        positions_->AddDocument(document_id, term_ids);
     }
     documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status});
     document_ids_.insert(document_id);
+    vocabulary_growth_.push_back(static_cast<uint32_t>(dictionary_.Size()));
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
@@ -35,6 +51,12 @@ std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query)
     return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
+std::vector<Document> SearchServer::FindTopDocumentsPage(std::string_view raw_query, size_t page, size_t page_size) const {
+    return FindTopDocumentsPage(raw_query, [](int document_id, DocumentStatus document_status, int rating) {
+        return document_status == DocumentStatus::ACTUAL;
+    }, page, page_size);
+}
+
 int SearchServer::GetDocumentCount() const {
     return documents_.size();
 }
@@ -54,8 +76,8 @@ bool SearchServer::IsValidWord(std::string_view word) {
     });
 }
 
-std::vector<std::string> SearchServer::SplitIntoWordsNoStop(std::string_view text) const {
-    std::vector<std::string> words;
+std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text) const {
+    std::vector<std::string_view> words;
     for (std::string_view word : SplitIntoWords(text)) {
         if (!IsValidWord(word)) {
             throw std::invalid_argument("Word is invalid");
@@ -88,43 +110,185 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) cons
         is_minus = true;
         word = word.substr(1);
     }
-    if (word.empty() || word[0] == '-' || !IsValidWord(word)) {
+    bool is_prefix = false;
+    if (!word.empty() && word.back() == '*') {
+        is_prefix = true;
+        word.remove_suffix(1);
+    }
+    if (word.empty() || word[0] == '-' || word.find('"') != word.npos || !IsValidWord(word)) {
         throw std::invalid_argument("Query word is invalid");
     }
 
-    return {word, is_minus, IsStopWord(word)};
+    return {word, is_minus, !is_prefix && IsStopWord(word), is_prefix};
 }
 
 SearchServer::Query SearchServer::ParseQuery(std::string_view text) const {
+    PROFILE_SCOPE("ParseQuery");
     Query result;
+    std::vector<std::string_view> phrase;
+    bool in_phrase = false;
     for (std::string_view word : SplitIntoWords(text)) {
-        const auto query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
-            if (query_word.is_minus) {
-                result.minus_words.insert(query_word.data);
-            } else {
+        if (!in_phrase && !word.empty() && word.front() == '"') {
+            in_phrase = true;
+            word.remove_prefix(1);
+        }
+        if (in_phrase) {
+            const bool is_phrase_end = !word.empty() && word.back() == '"';
+            if (is_phrase_end) {
+                word.remove_suffix(1);
+            }
+            const auto query_word = ParseQueryWord(word);
+            if (query_word.is_minus || query_word.is_prefix) {
+                throw std::invalid_argument("Phrase word is invalid");
+            }
+            // Стоп-слова не индексируются, поэтому и во фразе пропускаются
+            if (!query_word.is_stop) {
+                phrase.push_back(query_word.data);
                 result.plus_words.insert(query_word.data);
             }
+            if (is_phrase_end) {
+                in_phrase = false;
+                if (phrase.size() > 1) {
+                    result.phrases.push_back(std::move(phrase));
+                }
+                phrase.clear();
+            }
+            continue;
+        }
+
+        const auto query_word = ParseQueryWord(word);
+        if (query_word.is_stop) {
+            continue;
         }
+        if (query_word.is_prefix) {
+            (query_word.is_minus ? result.minus_prefixes : result.plus_prefixes).insert(query_word.data);
+        } else {
+            (query_word.is_minus ? result.minus_words : result.plus_words).insert(query_word.data);
+        }
+    }
+    if (in_phrase) {
+        throw std::invalid_argument("Phrase is not closed");
+    }
+    if (!result.phrases.empty() && !positions_) {
+        throw std::invalid_argument("Phrase queries require the positional index");
     }
     return result;
 }
 
-// Existence required
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string& word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+std::vector<Document> SearchServer::SelectTopDocuments(std::vector<PackedDocument>& documents, size_t first, size_t last) const {
+    PROFILE_SCOPE("SelectTopDocuments");
+    last = std::min(last, documents.size());
+    first = std::min(first, last);
+    std::partial_sort(documents.begin(), documents.begin() + last, documents.end(), [](const PackedDocument& lhs, const PackedDocument& rhs) {
+        if (std::abs(lhs.relevance - rhs.relevance) < 1e-6) {
+            return lhs.rating > rhs.rating;
+        } else {
+            return lhs.relevance > rhs.relevance;
+        }
+    });
+
+    std::vector<Document> top_documents;
+    top_documents.reserve(last - first);
+    for (size_t i = first; i < last; ++i) {
+        const PackedDocument& document = documents[i];
+        top_documents.push_back({document.id, document.relevance, document.rating});
+    }
+    return top_documents;
 }
 
-const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
-    static std::map<std::string_view, double> result;
-    if (document_to_word_freqs_.empty()) {
-        return result;
+double SearchServer::ComputeWordInverseDocumentFreq(TermDictionary::TermId term_id) const {
+    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_[term_id].size());
+}
+
+std::vector<SearchServer::QueryTerm> SearchServer::ExpandQueryTerms(const std::set<std::string_view>& words,
+                                                                    const std::set<std::string_view>& prefixes) const {
+    std::vector<TermDictionary::TermId> term_ids;
+    for (std::string_view word : words) {
+        if (const auto term_id = dictionary_.Find(word)) {
+            term_ids.push_back(*term_id);
+        }
+    }
+    for (std::string_view prefix : prefixes) {
+        dictionary_.ForEachWithPrefix(prefix, [&term_ids](TermDictionary::TermId term_id) {
+            term_ids.push_back(term_id);
+        });
+    }
+    if (!prefixes.empty()) {
+        std::sort(term_ids.begin(), term_ids.end());
+        term_ids.erase(std::unique(term_ids.begin(), term_ids.end()), term_ids.end());
     }
 
-    for (const auto& [k, v] : document_to_word_freqs_.at(document_id)) {
-        result.insert({k, v});
+    std::vector<QueryTerm> terms;
+    terms.reserve(term_ids.size());
+    for (const TermDictionary::TermId term_id : term_ids) {
+        // После RemoveDocument слово остаётся в словаре, но может больше не встречаться в документах
+        if (!word_to_document_freqs_[term_id].empty()) {
+            terms.push_back({&word_to_document_freqs_[term_id], ComputeWordInverseDocumentFreq(term_id)});
+        }
     }
-    return result;
+    return terms;
+}
+
+bool SearchServer::ContainsPhrases(const Query& query, int document_id) const {
+    for (const auto& phrase : query.phrases) {
+        std::vector<TermDictionary::TermId> term_ids;
+        for (std::string_view word : phrase) {
+            const auto term_id = dictionary_.Find(word);
+            if (!term_id) {
+                return false;
+            }
+            term_ids.push_back(*term_id);
+        }
+        if (!positions_->ContainsPhrase(document_id, term_ids)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SearchServer::ApplyPositionalScoring(const Query& query, std::vector<PackedDocument>& documents) const {
+    if (!positions_) {
+        return;
+    }
+
+    std::vector<TermDictionary::TermId> plus_term_ids;
+    for (std::string_view word : query.plus_words) {
+        if (const auto term_id = dictionary_.Find(word)) {
+            plus_term_ids.push_back(*term_id);
+        }
+    }
+    if (query.phrases.empty() && plus_term_ids.size() < 2) {
+        return;
+    }
+
+    PROFILE_SCOPE("ApplyPositionalScoring");
+    if (!query.phrases.empty()) {
+        documents.erase(std::remove_if(documents.begin(), documents.end(), [this, &query](const PackedDocument& document) {
+            return !ContainsPhrases(query, document.id);
+        }), documents.end());
+    }
+    if (plus_term_ids.size() >= 2) {
+        for (PackedDocument& document : documents) {
+            const uint32_t distance = positions_->ComputeMinimalDistance(document.id, plus_term_ids);
+            if (distance > 0) {
+                document.relevance *= 1.0 + PROXIMITY_WEIGHT / distance;
+            }
+        }
+    }
+}
+
+const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
+    static const std::map<std::string_view, double> empty_result;
+    const auto it = document_to_word_freqs_.find(document_id);
+    return it == document_to_word_freqs_.end() ? empty_result : it->second;
+}
+
+TermStatistics SearchServer::GetTermStatistics() const {
+    return GetTermStatistics(std::execution::seq);
+}
+
+const std::vector<uint32_t>& SearchServer::GetVocabularyGrowth() const {
+    return vocabulary_growth_;
 }
 
 std::set<int>::const_iterator SearchServer::begin() const {
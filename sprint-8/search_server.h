@@ -11,22 +11,41 @@
 #include <algorithm>
 #include <execution>
 #include <functional>
+#include <limits>
+#include <numeric>
+#include <optional>
 
 #include "document.h"
 #include "string_processing.h"
 #include "concurrent_map.h"
+#include "profile.h"
+#include "term_dictionary.h"
+#include "positional_index.h"
+#include "term_statistics.h"
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
 
+// С позиционным индексом сервер понимает фразовые запросы ("white cat")
+// и поднимает документы, в которых слова запроса стоят близко друг к другу
+enum class PositionalIndexMode {
+    DISABLED,
+    ENABLED,
+};
+
 class SearchServer {
 public:
     template <typename StringContainer>
-    SearchServer(const StringContainer& stop_words);
-    SearchServer(const std::string& stop_words_text);
-    SearchServer(std::string_view stop_words_text);
+    SearchServer(const StringContainer& stop_words, PositionalIndexMode positional_index_mode = PositionalIndexMode::DISABLED);
+    SearchServer(const std::string& stop_words_text, PositionalIndexMode positional_index_mode = PositionalIndexMode::DISABLED);
+    SearchServer(std::string_view stop_words_text, PositionalIndexMode positional_index_mode = PositionalIndexMode::DISABLED);
 
     void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
 
+    // Слова документов выделяются параллельно, индекс пополняется последовательно.
+    // Если хоть один документ некорректен, не добавляется ни один.
+    template <typename ExecutionPolicy>
+    void AddDocuments(ExecutionPolicy policy, const std::vector<DocumentRecord>& documents);
+
     template <typename DocumentPredicate, typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate) const;
 
@@ -38,6 +57,13 @@ public:
     std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
     std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
 
+    // Возвращает страницу page выдачи. Поиск по индексу выполняется полностью, как в FindTopDocuments,
+    // ограничена только сортировка: упорядочиваются первые (page + 1) * page_size документов.
+    // Для страницы, номер которой не помещается в size_t вместе с размером, возвращается пустой результат
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsPage(std::string_view raw_query, DocumentPredicate document_predicate, size_t page, size_t page_size) const;
+    std::vector<Document> FindTopDocumentsPage(std::string_view raw_query, size_t page, size_t page_size) const;
+
     int GetDocumentCount() const;
 
     template <typename ExecutionPolicy>
@@ -45,6 +71,13 @@ public:
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
     const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
 
+    // Статистика по всем словам, собранная параллельным проходом по спискам документов
+    template <typename ExecutionPolicy>
+    TermStatistics GetTermStatistics(ExecutionPolicy policy) const;
+    TermStatistics GetTermStatistics() const;
+    // i-й элемент — размер словаря после добавления i + 1 документов
+    const std::vector<uint32_t>& GetVocabularyGrowth() const;
+
     template <typename ExecutionPolicy>
     void RemoveDocument(ExecutionPolicy policy, int document_id);
     void RemoveDocument(int document_id);
@@ -52,27 +85,39 @@ public:
     std::set<int>::const_iterator begin() const;
     std::set<int>::const_iterator end() const;
 private:
+    using Postings = std::map<int, double>;
+
     struct DocumentData {
         int rating;
         DocumentStatus status;
     };
     std::set<int> document_ids_;
     const std::set<std::string, std::less<>> stop_words_;
-    std::map<std::string, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, std::map<std::string, double>> document_to_word_freqs_;
+    TermDictionary dictionary_;
+    // Индекс — TermId слова в dictionary_
+    std::vector<Postings> word_to_document_freqs_;
+    std::map<int, std::map<std::string_view, double>> document_to_word_freqs_;
     std::map<int, DocumentData> documents_;
+    std::optional<PositionalIndex> positions_;
+    std::vector<uint32_t> vocabulary_growth_;
+
+    // Документ, где ближайшие слова запроса стоят на расстоянии d, получает релевантность * (1 + PROXIMITY_WEIGHT / d)
+    static constexpr double PROXIMITY_WEIGHT = 0.5;
 
     bool IsStopWord(std::string_view word) const;
     static bool IsValidWord(std::string_view word);
 
-    std::vector<std::string> SplitIntoWordsNoStop(std::string_view text) const;
+    std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const;
 
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
+    void IndexDocument(int document_id, const std::vector<std::string_view>& words, DocumentStatus status, const std::vector<int>& ratings);
+
     struct QueryWord {
         std::string_view data;
         bool is_minus;
         bool is_stop;
+        bool is_prefix;
     };
 
     QueryWord ParseQueryWord(std::string_view text) const;
@@ -80,47 +125,91 @@ private:
     struct Query {
         std::set<std::string_view> plus_words;
         std::set<std::string_view> minus_words;
+        // Слова запроса вида "word*" без завершающей звёздочки
+        std::set<std::string_view> plus_prefixes;
+        std::set<std::string_view> minus_prefixes;
+        // Фразы в кавычках из нескольких слов; их слова есть и в plus_words
+        std::vector<std::vector<std::string_view>> phrases;
     };
 
     Query ParseQuery(std::string_view text) const;
 
-    // Existence required
-    double ComputeWordInverseDocumentFreq(const std::string& word) const;
+    double ComputeWordInverseDocumentFreq(TermDictionary::TermId term_id) const;
+
+    struct QueryTerm {
+        const Postings* postings;
+        double inverse_document_freq;
+    };
+
+    // Слова словаря, совпадающие со словами запроса или начинающиеся с его префиксов
+    std::vector<QueryTerm> ExpandQueryTerms(const std::set<std::string_view>& words, const std::set<std::string_view>& prefixes) const;
+
+    // Отбрасывает документы без фраз запроса и учитывает близость слов; работает только с позиционным индексом
+    void ApplyPositionalScoring(const Query& query, std::vector<PackedDocument>& documents) const;
+    bool ContainsPhrases(const Query& query, int document_id) const;
+
+    template <typename Callback>
+    static void MergePostings(const std::vector<QueryTerm>& terms, Callback callback);
+
+    // Упорядочивает первые last документов и возвращает позиции [first, last) выдачи
+    std::vector<Document> SelectTopDocuments(std::vector<PackedDocument>& documents, size_t first, size_t last) const;
 
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const;
+    std::vector<PackedDocument> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const;
 
     template <typename DocumentPredicate, typename ExecutionPolicy>
-    std::vector<Document> FindAllDocuments(ExecutionPolicy policy, const Query& query, DocumentPredicate document_predicate) const;
+    std::vector<PackedDocument> FindAllDocuments(ExecutionPolicy policy, const Query& query, DocumentPredicate document_predicate) const;
 };
 
 template <typename StringContainer>
-SearchServer::SearchServer(const StringContainer& stop_words)
+SearchServer::SearchServer(const StringContainer& stop_words, PositionalIndexMode positional_index_mode)
         : stop_words_(MakeUniqueNonEmptyStrings(stop_words))  // Extract non-empty stop words
 {
     using namespace std;
     if (!all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
         throw invalid_argument("Some of stop words are invalid"s);
     }
+    if (positional_index_mode == PositionalIndexMode::ENABLED) {
+        positions_.emplace();
+    }
 }
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
-    const auto query = ParseQuery(raw_query);
-    auto matched_documents = FindAllDocuments(query, document_predicate);
+template <typename ExecutionPolicy>
+void SearchServer::AddDocuments(ExecutionPolicy policy, const std::vector<DocumentRecord>& documents) {
+    PROFILE_SCOPE("AddDocuments");
+    std::set<int> batch_ids;
+    for (const DocumentRecord& document : documents) {
+        if (document.id < 0 || documents_.count(document.id) > 0 || !batch_ids.insert(document.id).second) {
+            throw std::invalid_argument("Invalid document_id");
+        }
+    }
 
-    sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-        if (std::abs(lhs.relevance - rhs.relevance) < 1e-6) {
-            return lhs.rating > rhs.rating;
-        } else {
-            return lhs.relevance > rhs.relevance;
+    // Исключение внутри параллельного алгоритма завершило бы программу, поэтому ошибки только отмечаются
+    std::vector<char> is_invalid(documents.size(), false);
+    std::vector<std::vector<std::string_view>> words(documents.size());
+    std::transform(policy, documents.begin(), documents.end(), words.begin(), [&](const DocumentRecord& document) {
+        try {
+            return SplitIntoWordsNoStop(document.text);
+        } catch (const std::invalid_argument&) {
+            is_invalid[&document - documents.data()] = true;
+            return std::vector<std::string_view>{};
         }
     });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    if (std::find(is_invalid.begin(), is_invalid.end(), true) != is_invalid.end()) {
+        throw std::invalid_argument("Word is invalid");
     }
 
-    return matched_documents;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        IndexDocument(documents[i].id, words[i], documents[i].status, documents[i].ratings);
+    }
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
+    PROFILE_SCOPE("FindTopDocuments");
+    const auto query = ParseQuery(raw_query);
+    auto matched_documents = FindAllDocuments(query, document_predicate);
+    return SelectTopDocuments(matched_documents, 0, MAX_RESULT_DOCUMENT_COUNT);
 }
 
 template<typename ExecutionPolicy>
@@ -133,123 +222,223 @@ std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy policy, std
 template<typename DocumentPredicate, typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query,
                                                      DocumentPredicate document_predicate) const {
+    PROFILE_SCOPE("FindTopDocuments");
     const auto query = ParseQuery(raw_query);
     auto matched_documents = FindAllDocuments(policy, query, document_predicate);
+    return SelectTopDocuments(matched_documents, 0, MAX_RESULT_DOCUMENT_COUNT);
+}
 
-    sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-        if (std::abs(lhs.relevance - rhs.relevance) < 1e-6) {
-            return lhs.rating > rhs.rating;
-        } else {
-            return lhs.relevance > rhs.relevance;
-        }
-    });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsPage(std::string_view raw_query, DocumentPredicate document_predicate,
+                                                         size_t page, size_t page_size) const {
+    PROFILE_SCOPE("FindTopDocumentsPage");
+    if (page_size == 0 || page >= std::numeric_limits<size_t>::max() / page_size) {
+        return {};
     }
+    const auto query = ParseQuery(raw_query);
+    auto matched_documents = FindAllDocuments(query, document_predicate);
 
-    return matched_documents;
+    return SelectTopDocuments(matched_documents, page * page_size, (page + 1) * page_size);
 }
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const {
-    std::map<int, double> document_to_relevance;
-    for (std::string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(std::string(word)) == 0) {
-            continue;
+// k-way слияние списков документов через кучу: callback(document_id, relevance) вызывается
+// по возрастанию document_id, релевантность уже просуммирована по всем словам
+template <typename Callback>
+void SearchServer::MergePostings(const std::vector<QueryTerm>& terms, Callback callback) {
+    struct Cursor {
+        Postings::const_iterator current;
+        Postings::const_iterator end;
+        double inverse_document_freq;
+    };
+    const auto greater_document = [](const Cursor& lhs, const Cursor& rhs) {
+        return lhs.current->first > rhs.current->first;
+    };
+
+    std::vector<Cursor> heap;
+    heap.reserve(terms.size());
+    for (const QueryTerm& term : terms) {
+        if (!term.postings->empty()) {
+            heap.push_back({term.postings->begin(), term.postings->end(), term.inverse_document_freq});
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(std::string(word));
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(std::string(word))) {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+    }
+    std::make_heap(heap.begin(), heap.end(), greater_document);
+
+    while (!heap.empty()) {
+        const int document_id = heap.front().current->first;
+        double relevance = 0.0;
+        while (!heap.empty() && heap.front().current->first == document_id) {
+            std::pop_heap(heap.begin(), heap.end(), greater_document);
+            Cursor& cursor = heap.back();
+            relevance += cursor.current->second * cursor.inverse_document_freq;
+            if (++cursor.current == cursor.end) {
+                heap.pop_back();
+            } else {
+                std::push_heap(heap.begin(), heap.end(), greater_document);
             }
         }
+        callback(document_id, relevance);
     }
+}
 
-    for (std::string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(std::string(word)) == 0) {
-            continue;
+template <typename DocumentPredicate>
+std::vector<PackedDocument> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const {
+    PROFILE_SCOPE("FindAllDocuments");
+    std::vector<int> minus_documents;
+    MergePostings(ExpandQueryTerms(query.minus_words, query.minus_prefixes), [&minus_documents](int document_id, double) {
+        minus_documents.push_back(document_id);
+    });
+
+    std::vector<PackedDocument> matched_documents;
+    auto minus_it = minus_documents.begin();
+    MergePostings(ExpandQueryTerms(query.plus_words, query.plus_prefixes), [&](int document_id, double relevance) {
+        minus_it = std::lower_bound(minus_it, minus_documents.end(), document_id);
+        if (minus_it != minus_documents.end() && *minus_it == document_id) {
+            return;
         }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(std::string(word))) {
-            document_to_relevance.erase(document_id);
+        const auto& document_data = documents_.at(document_id);
+        if (document_predicate(document_id, document_data.status, document_data.rating)) {
+            matched_documents.push_back({document_id, relevance, document_data.rating});
         }
-    }
-
-    std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
-    }
+    });
+    ApplyPositionalScoring(query, matched_documents);
     return matched_documents;
 }
 
 template<typename DocumentPredicate, typename ExecutionPolicy>
-std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy policy, const SearchServer::Query &query,
+std::vector<PackedDocument> SearchServer::FindAllDocuments(ExecutionPolicy policy, const SearchServer::Query &query,
                                                      DocumentPredicate document_predicate) const {
+    PROFILE_SCOPE("FindAllDocuments");
     ConcurrentMap<int, double> document_to_relevance(100);
 
-    std::for_each(policy, query.plus_words.begin(), query.plus_words.end(), [&](std::string_view word) {
-        if (word_to_document_freqs_.count(std::string(word)) > 0) {
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(std::string(word));
-            for (const auto [document_id, term_freq] : word_to_document_freqs_.at(std::string(word))) {
-                const auto& document_data = documents_.at(document_id);
-                if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                    document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
-                }
+    const auto plus_terms = ExpandQueryTerms(query.plus_words, query.plus_prefixes);
+    std::for_each(policy, plus_terms.begin(), plus_terms.end(), [&](const QueryTerm& term) {
+        for (const auto [document_id, term_freq] : *term.postings) {
+            const auto& document_data = documents_.at(document_id);
+            if (document_predicate(document_id, document_data.status, document_data.rating)) {
+                document_to_relevance[document_id].ref_to_value += term_freq * term.inverse_document_freq;
             }
         }
     });
 
-    std::for_each(policy, query.minus_words.begin(), query.minus_words.end(), [&](std::string_view word) {
-        if (word_to_document_freqs_.count(std::string(word)) > 0) {
-            for (const auto [document_id, _] : word_to_document_freqs_.at(std::string(word))) {
-                document_to_relevance.BuildOrdinaryMap().erase(document_id);
-            }
+    // Минус-слова вычёркиваются из уже собранного словаря: BuildOrdinaryMap возвращает копию
+    auto ordinary_document_to_relevance = document_to_relevance.BuildOrdinaryMap();
+    for (const QueryTerm& term : ExpandQueryTerms(query.minus_words, query.minus_prefixes)) {
+        for (const auto [document_id, _] : *term.postings) {
+            ordinary_document_to_relevance.erase(document_id);
         }
-    });
+    }
 
-    std::vector<Document> matched_documents;
-    for (const auto &[document_id, relevance] : document_to_relevance.BuildOrdinaryMap()) {
+    std::vector<PackedDocument> matched_documents;
+    for (const auto &[document_id, relevance] : ordinary_document_to_relevance) {
         matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
     }
+    ApplyPositionalScoring(query, matched_documents);
 
     return matched_documents;
 }
 
 template<typename ExecutionPolicy>
 void SearchServer::RemoveDocument(ExecutionPolicy policy, int document_id) {
-    documents_.erase(document_id);
+    const auto document_it = document_to_word_freqs_.find(document_id);
+    if (document_it == document_to_word_freqs_.end()) {
+        return;
+    }
 
-    std::vector<std::string_view> words;
-    for (auto [word, _] : GetWordFrequencies(document_id)) {
-        words.push_back(word);
+    std::vector<TermDictionary::TermId> term_ids;
+    std::vector<Postings*> postings;
+    term_ids.reserve(document_it->second.size());
+    postings.reserve(document_it->second.size());
+    for (const auto [word, _] : document_it->second) {
+        term_ids.push_back(*dictionary_.Find(word));
+        postings.push_back(&word_to_document_freqs_[term_ids.back()]);
+    }
+    if (positions_) {
+        positions_->RemoveDocument(document_id, term_ids);
     }
 
-    std::for_each(policy, words.begin(), words.end(), [&](std::string_view word) {
-        if (word_to_document_freqs_.count(std::string(word)) > 0) {
-            word_to_document_freqs_.at(std::string(word)).erase(document_id);
-        }
+    // Каждый список документов принадлежит своему слову, поэтому их можно чистить параллельно
+    std::for_each(policy, postings.begin(), postings.end(), [document_id](Postings* word_postings) {
+        word_postings->erase(document_id);
     });
 
-    document_to_word_freqs_.erase(document_id);
+    document_to_word_freqs_.erase(document_it);
+    documents_.erase(document_id);
     document_ids_.erase(document_id);
 }
 
+template <typename ExecutionPolicy>
+TermStatistics SearchServer::GetTermStatistics(ExecutionPolicy policy) const {
+    PROFILE_SCOPE("GetTermStatistics");
+    const size_t term_count = word_to_document_freqs_.size();
+    std::vector<TermDictionary::TermId> term_ids(term_count);
+    std::iota(term_ids.begin(), term_ids.end(), 0);
+
+    TermStatistics all_terms;
+    all_terms.document_counts.resize(term_count);
+    for (auto& counts : all_terms.status_document_counts) {
+        counts.resize(term_count);
+    }
+    // Каждое слово заполняет только свою строку, поэтому синхронизация не нужна
+    std::for_each(policy, term_ids.begin(), term_ids.end(), [&](TermDictionary::TermId term_id) {
+        const Postings& postings = word_to_document_freqs_[term_id];
+        all_terms.document_counts[term_id] = static_cast<uint32_t>(postings.size());
+        for (const auto [document_id, _] : postings) {
+            ++all_terms.status_document_counts[static_cast<size_t>(documents_.at(document_id).status)][term_id];
+        }
+    });
+
+    // Слова, оставшиеся в словаре после удаления всех их документов, в снимок не попадают
+    TermStatistics statistics;
+    for (const TermDictionary::TermId term_id : term_ids) {
+        if (all_terms.document_counts[term_id] == 0) {
+            continue;
+        }
+        statistics.words.push_back(dictionary_.GetTerm(term_id));
+        statistics.document_counts.push_back(all_terms.document_counts[term_id]);
+        for (size_t status = 0; status < DOCUMENT_STATUS_COUNT; ++status) {
+            statistics.status_document_counts[status].push_back(all_terms.status_document_counts[status][term_id]);
+        }
+    }
+    return statistics;
+}
+
 template <typename ExecutionPolicy>
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(ExecutionPolicy policy, std::string_view raw_query, int document_id) const {
     const auto query = ParseQuery(raw_query);
-    std::vector<std::string_view> matched_words;
+    const DocumentStatus status = documents_.at(document_id).status;
 
-    std::for_each(policy, query.plus_words.begin(), query.plus_words.end(), [&](std::string_view word) {
-        if (word_to_document_freqs_.at(std::string(word)).count(document_id) > 0) {
-            matched_words.push_back(word);
-        }
-    });
+    const auto contains_document = [this, document_id](TermDictionary::TermId term_id) {
+        return word_to_document_freqs_[term_id].count(document_id) > 0;
+    };
+    const auto word_matches = [&](std::string_view word) {
+        const auto term_id = dictionary_.Find(word);
+        return term_id && contains_document(*term_id);
+    };
 
-    std::for_each(policy, query.minus_words.begin(), query.minus_words.end(), [&](std::string_view word) {
-        if (word_to_document_freqs_.at(std::string(word)).count(document_id) > 0) {
-            matched_words.clear();
+    bool has_minus_word = std::any_of(policy, query.minus_words.begin(), query.minus_words.end(), word_matches);
+    for (std::string_view prefix : query.minus_prefixes) {
+        dictionary_.ForEachWithPrefix(prefix, [&](TermDictionary::TermId term_id) {
+            has_minus_word = has_minus_word || contains_document(term_id);
+        });
+    }
+    if (has_minus_word || !ContainsPhrases(query, document_id)) {
+        return {std::vector<std::string_view>{}, status};
+    }
+
+    std::vector<std::string_view> matched_words(query.plus_words.size());
+    matched_words.erase(std::copy_if(policy, query.plus_words.begin(), query.plus_words.end(), matched_words.begin(), word_matches),
+                        matched_words.end());
+    if (!query.plus_prefixes.empty()) {
+        for (std::string_view prefix : query.plus_prefixes) {
+            dictionary_.ForEachWithPrefix(prefix, [&](TermDictionary::TermId term_id) {
+                if (contains_document(term_id)) {
+                    matched_words.push_back(dictionary_.GetTerm(term_id));
+                }
+            });
         }
-    });
+        std::sort(matched_words.begin(), matched_words.end());
+        matched_words.erase(std::unique(matched_words.begin(), matched_words.end()), matched_words.end());
+    }
 
-    return {matched_words, documents_.at(document_id).status};
-}
\ No newline at end of file
+    return {matched_words, status};
+}
@@ -0,0 +1,122 @@
+#include "term_dictionary.h"
+
+#include <cstring>
+#include <utility>
+
+using namespace std;
+
+TermDictionary::TermDictionary(const TermDictionary& other)
+        : chunks_(other.chunks_)
+        , terms_(other.terms_)
+        , ids_(other.ids_)
+        , sorted_ids_(other.sorted_ids_)
+        , pending_ids_(other.pending_ids_) {
+    // Хвост текущего куска остаётся за other, копия начнёт писать в новый кусок
+}
+
+TermDictionary& TermDictionary::operator=(const TermDictionary& other) {
+    if (this != &other) {
+        chunks_ = other.chunks_;
+        current_chunk_ = nullptr;
+        chunk_used_ = 0;
+        terms_ = other.terms_;
+        ids_ = other.ids_;
+        sorted_ids_ = other.sorted_ids_;
+        pending_ids_ = other.pending_ids_;
+    }
+    return *this;
+}
+
+TermDictionary::TermDictionary(TermDictionary&& other) noexcept
+        : chunks_(move(other.chunks_))
+        , current_chunk_(exchange(other.current_chunk_, nullptr))
+        , chunk_used_(exchange(other.chunk_used_, 0))
+        , terms_(move(other.terms_))
+        , ids_(move(other.ids_))
+        , sorted_ids_(move(other.sorted_ids_))
+        , pending_ids_(move(other.pending_ids_)) {
+}
+
+TermDictionary& TermDictionary::operator=(TermDictionary&& other) noexcept {
+    if (this != &other) {
+        chunks_ = move(other.chunks_);
+        current_chunk_ = exchange(other.current_chunk_, nullptr);
+        chunk_used_ = exchange(other.chunk_used_, 0);
+        terms_ = move(other.terms_);
+        ids_ = move(other.ids_);
+        sorted_ids_ = move(other.sorted_ids_);
+        pending_ids_ = move(other.pending_ids_);
+    }
+    return *this;
+}
+
+TermDictionary::TermId TermDictionary::Insert(string_view term) {
+    if (const auto it = ids_.find(term); it != ids_.end()) {
+        return it->second;
+    }
+
+    const auto id = static_cast<TermId>(terms_.size());
+    const string_view stored = StoreText(term);
+    terms_.push_back(stored);
+    ids_.emplace(stored, id);
+    pending_ids_.emplace(stored, id);
+
+    if (pending_ids_.size() >= max(MIN_PENDING_MERGE_SIZE, sorted_ids_.size() / 8)) {
+        MergePending();
+    }
+    return id;
+}
+
+optional<TermDictionary::TermId> TermDictionary::Find(string_view term) const {
+    if (const auto it = ids_.find(term); it != ids_.end()) {
+        return it->second;
+    }
+    return nullopt;
+}
+
+string_view TermDictionary::GetTerm(TermId id) const {
+    return terms_[id];
+}
+
+size_t TermDictionary::Size() const {
+    return terms_.size();
+}
+
+string_view TermDictionary::StoreText(string_view term) {
+    // Слишком длинное слово получает собственный кусок, текущий продолжает заполняться
+    if (term.size() > CHUNK_SIZE / 2) {
+        chunks_.emplace_back(new char[term.size()]);
+        memcpy(chunks_.back().get(), term.data(), term.size());
+        return {chunks_.back().get(), term.size()};
+    }
+
+    if (current_chunk_ == nullptr || term.size() > CHUNK_SIZE - chunk_used_) {
+        chunks_.emplace_back(new char[CHUNK_SIZE]);
+        current_chunk_ = chunks_.back().get();
+        chunk_used_ = 0;
+    }
+
+    char* data = current_chunk_ + chunk_used_;
+    memcpy(data, term.data(), term.size());
+    chunk_used_ += term.size();
+    return {data, term.size()};
+}
+
+void TermDictionary::MergePending() {
+    vector<TermId> merged;
+    merged.reserve(sorted_ids_.size() + pending_ids_.size());
+
+    auto pending_it = pending_ids_.begin();
+    for (const TermId id : sorted_ids_) {
+        for (; pending_it != pending_ids_.end() && pending_it->first < terms_[id]; ++pending_it) {
+            merged.push_back(pending_it->second);
+        }
+        merged.push_back(id);
+    }
+    for (; pending_it != pending_ids_.end(); ++pending_it) {
+        merged.push_back(pending_it->second);
+    }
+
+    sorted_ids_ = move(merged);
+    pending_ids_.clear();
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Словарь слов поискового индекса. Каждое слово хранится один раз в арене и получает
+// плотный TermId, по которому индексируются списки документов. string_view на слова
+// остаются валидными всё время жизни словаря и его копий: копии делят уже заполненные куски арены.
+// Для префиксного поиска ids поддерживаются отсортированными по тексту: новые слова копятся
+// в небольшом буфере и вливаются в отсортированный массив, когда буфер разрастается.
+class TermDictionary {
+public:
+    using TermId = uint32_t;
+
+    TermDictionary() = default;
+    TermDictionary(const TermDictionary& other);
+    TermDictionary& operator=(const TermDictionary& other);
+    // Хвост текущего куска переходит к новому владельцу: перемещённый словарь больше в него не пишет
+    TermDictionary(TermDictionary&& other) noexcept;
+    TermDictionary& operator=(TermDictionary&& other) noexcept;
+
+    TermId Insert(std::string_view term);
+    std::optional<TermId> Find(std::string_view term) const;
+    std::string_view GetTerm(TermId id) const;
+    size_t Size() const;
+
+    // Вызывает callback(TermId) для каждого слова, начинающегося с prefix; порядок не гарантируется
+    template <typename Callback>
+    void ForEachWithPrefix(std::string_view prefix, Callback callback) const;
+
+private:
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+    static constexpr size_t MIN_PENDING_MERGE_SIZE = 1024;
+
+    std::string_view StoreText(std::string_view term);
+    void MergePending();
+
+    std::vector<std::shared_ptr<char[]>> chunks_;
+    char* current_chunk_ = nullptr;
+    size_t chunk_used_ = 0;
+
+    std::vector<std::string_view> terms_;
+    std::unordered_map<std::string_view, TermId> ids_;
+    std::vector<TermId> sorted_ids_;
+    std::map<std::string_view, TermId> pending_ids_;
+};
+
+template <typename Callback>
+void TermDictionary::ForEachWithPrefix(std::string_view prefix, Callback callback) const {
+    const auto has_prefix = [prefix](std::string_view term) {
+        return term.substr(0, prefix.size()) == prefix;
+    };
+
+    auto it = std::lower_bound(sorted_ids_.begin(), sorted_ids_.end(), prefix, [this](TermId id, std::string_view value) {
+        return terms_[id] < value;
+    });
+    for (; it != sorted_ids_.end() && has_prefix(terms_[*it]); ++it) {
+        callback(*it);
+    }
+
+    for (auto pending_it = pending_ids_.lower_bound(prefix); pending_it != pending_ids_.end() && has_prefix(pending_it->first); ++pending_it) {
+        callback(pending_it->second);
+    }
+}
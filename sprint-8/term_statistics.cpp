@@ -0,0 +1,31 @@
+#include "term_statistics.h"
+
+#include <algorithm>
+#include <numeric>
+
+using namespace std;
+
+size_t TermStatistics::Size() const {
+    return words.size();
+}
+
+vector<size_t> TermStatistics::FindTopByDocumentCount(size_t count) const {
+    vector<size_t> rows(Size());
+    iota(rows.begin(), rows.end(), 0);
+    const auto middle = rows.begin() + min(count, rows.size());
+    partial_sort(rows.begin(), middle, rows.end(), [this](size_t lhs, size_t rhs) {
+        if (document_counts[lhs] != document_counts[rhs]) {
+            return document_counts[lhs] > document_counts[rhs];
+        }
+        return words[lhs] < words[rhs];
+    });
+    rows.erase(middle, rows.end());
+    return rows;
+}
+
+size_t TermStatistics::CountWordsWithStatus(DocumentStatus status) const {
+    const auto& counts = status_document_counts[static_cast<size_t>(status)];
+    return count_if(counts.begin(), counts.end(), [](uint32_t document_count) {
+        return document_count > 0;
+    });
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+
+const size_t DOCUMENT_STATUS_COUNT = 4;
+
+// Снимок статистики слов индекса в колоночном виде: i-е элементы всех столбцов относятся к одному слову.
+// string_view указывают в словарь сервера и живут, пока жив сервер.
+struct TermStatistics {
+    std::vector<std::string_view> words;
+    // Число документов, в которых встречается слово
+    std::vector<uint32_t> document_counts;
+    // То же число в разбивке по статусам документов; индекс — static_cast<size_t>(DocumentStatus)
+    std::array<std::vector<uint32_t>, DOCUMENT_STATUS_COUNT> status_document_counts;
+
+    size_t Size() const;
+
+    // Номера строк count слов с наибольшим числом документов, по убыванию
+    std::vector<size_t> FindTopByDocumentCount(size_t count) const;
+
+    // Сколько разных слов встречается в документах со статусом status
+    size_t CountWordsWithStatus(DocumentStatus status) const;
+};
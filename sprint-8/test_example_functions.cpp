@@ -1,5 +1,8 @@
 #include "test_example_functions.h"
 #include "search_server.h"
+#include "paginator.h"
+
+#include <limits>
 
 using namespace std;
 
@@ -23,3 +26,45 @@ void AssertImpl(bool value, const string& expr_str, const string& file, const st
 #define ASSERT_HINT(expr, hint) AssertImpl(!!(expr), #expr, __FILE__, __FUNCTION__, __LINE__, hint)
 
 #define RUN_TEST(func) RunTestImpl(func, #func)
+
+namespace {
+
+void TestPaginatorPages() {
+    const vector<int> items = {1, 2, 3, 4, 5};
+    const auto pages = Paginate(items, 2);
+    ASSERT_EQUAL(pages.size(), 3u);
+    ASSERT_EQUAL(vector<int>(pages[0].begin(), pages[0].end()), (vector<int>{1, 2}));
+    ASSERT_EQUAL(vector<int>(pages[2].begin(), pages[2].end()), vector<int>{5});
+    ASSERT_EQUAL(pages[2].size(), 1u);
+
+    size_t page_count = 0;
+    size_t item_count = 0;
+    for (const auto& page : pages) {
+        ++page_count;
+        item_count += page.size();
+    }
+    ASSERT_EQUAL(page_count, 3u);
+    ASSERT_EQUAL(item_count, items.size());
+}
+
+void TestPaginatorPagesOutOfRange() {
+    const vector<int> items = {1, 2, 3, 4, 5};
+    const auto pages = Paginate(items, 2);
+    ASSERT_EQUAL(pages[3].size(), 0u);
+    ASSERT(pages[3].begin() == pages[3].end());
+    // page * page_size переполняет size_t и без проверки дало бы малое смещение внутрь данных
+    const size_t huge_page = numeric_limits<size_t>::max() / 2 + 1;
+    ASSERT_EQUAL(pages[huge_page].size(), 0u);
+    ASSERT(pages[huge_page].begin() == items.end());
+
+    const auto no_pages = Paginate(items, 0);
+    ASSERT_EQUAL(no_pages.size(), 0u);
+    ASSERT_EQUAL(no_pages[0].size(), 0u);
+}
+
+} // namespace
+
+void TestPaginator() {
+    RUN_TEST(TestPaginatorPages);
+    RUN_TEST(TestPaginatorPagesOutOfRange);
+}
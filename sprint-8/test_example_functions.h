@@ -70,6 +70,9 @@ void AssertEqualImpl(const T& t, const U& u, const std::string& t_str, const std
     }
 }
 
+// Проверки Paginator, прерывают программу при ошибке
+void TestPaginator();
+
 void AssertImpl(bool value, const std::string& expr_str, const std::string& file, const std::string& func, unsigned line,
                 const std::string& hint);
 